@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <cerrno>
+#include <poll.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+// Run every container suite in its own forked child, pinned to one core.
+// The child starts from a fresh copy of the parent heap (nothing left by the
+// previous suite) and cannot be migrated by the scheduler mid-measurement.
+// Results are sent back through a pipe and printed in order by the parent,
+// which samples the frequency of the core every 20 ms while the child runs:
+// a sampler in the child would share the pinned core with the suite.
+class IsolatedRunner
+{
+public:
+    using Suite = void (*)(std::ostream&);
+
+    explicit IsolatedRunner(int cpu)
+        : _cpu(cpu)
+    {}
+
+    // cpu can be put in a cpu_set_t
+    static bool validCpu(long cpu)
+    {
+#ifdef __linux__
+        return cpu >= 0 && cpu < CPU_SETSIZE;
+#else
+        return cpu >= 0;
+#endif
+    }
+
+    void add(Suite suite)
+    {
+        _suites.push_back(suite);
+    }
+
+    // Returns false when one of the suites failed or the frequency moved.
+    bool run(std::ostream& stream)
+    {
+        bool ok = checkGovernor();
+
+        for (auto suite : _suites)
+        {
+            FrequencyRange frequencies;
+            ok &= runChild(suite, stream, frequencies);
+
+            // more than 5% of drift: the figures of this suite are not comparable
+            if (frequencies.min != 0 && (frequencies.max - frequencies.min) * 20 > frequencies.max)
+            {
+                std::cerr << "warning: cpu" << _cpu << " frequency moved between "
+                          << frequencies.min << " and " << frequencies.max << " kHz" << std::endl;
+                ok = false;
+            }
+        }
+        return ok;
+    }
+
+private:
+    static const int samplePeriodMs = 20;
+
+    // lowest and highest frequency seen, 0 when there was none to read
+    struct FrequencyRange
+    {
+        uint64_t min = 0;
+        uint64_t max = 0;
+
+        void add(uint64_t frequency)
+        {
+            if (frequency == 0)
+                return;
+            if (min == 0 || frequency < min)
+                min = frequency;
+            if (frequency > max)
+                max = frequency;
+        }
+    };
+
+    std::string sysfs(char const* file) const
+    {
+        std::ifstream input("/sys/devices/system/cpu/cpu" + std::to_string(_cpu) + "/cpufreq/" + file);
+        std::string value;
+        input >> value;
+        return value;
+    }
+
+    uint64_t currentFrequency() const
+    {
+        std::string value = sysfs("scaling_cur_freq");
+        return value.empty() ? 0 : std::strtoull(value.c_str(), nullptr, 10);
+    }
+
+    bool checkGovernor() const
+    {
+        std::string governor = sysfs("scaling_governor");
+        if (governor.empty())
+        {
+            std::cerr << "warning: no cpufreq information for cpu" << _cpu << std::endl;
+            return true;
+        }
+        if (governor != "performance")
+        {
+            std::cerr << "warning: cpu" << _cpu << " governor is '" << governor
+                      << "', frequency may change during the benchmark" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+#ifdef __linux__
+    bool runChild(Suite suite, std::ostream& stream, FrequencyRange& frequencies)
+    {
+        int fds[2];
+        if (::pipe(fds) != 0)
+        {
+            std::cerr << "IsolatedRunner: pipe failed" << std::endl;
+            return false;
+        }
+
+        std::cout.flush();
+        pid_t pid = ::fork();
+        if (pid < 0)
+        {
+            std::cerr << "IsolatedRunner: fork failed" << std::endl;
+            ::close(fds[0]);
+            ::close(fds[1]);
+            return false;
+        }
+
+        if (pid == 0)
+        {
+            ::close(fds[0]);
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if (validCpu(_cpu))
+                CPU_SET(_cpu, &set);
+            if (!validCpu(_cpu) || ::sched_setaffinity(0, sizeof(set), &set) != 0)
+            {
+                std::cerr << "IsolatedRunner: cannot pin to cpu" << _cpu << std::endl;
+                ::_exit(1);
+            }
+
+            std::ostringstream result;
+            suite(result);
+            std::string const& data = result.str();
+            size_t written = 0;
+            while (written < data.size())
+            {
+                ssize_t n = ::write(fds[1], data.data() + written, data.size() - written);
+                if (n <= 0)
+                    ::_exit(1);
+                written += static_cast<size_t>(n);
+            }
+            ::close(fds[1]);
+            ::_exit(0);
+        }
+
+        ::close(fds[1]);
+        char buffer[4096];
+        struct pollfd result = {fds[0], POLLIN, 0};
+        for (;;)
+        {
+            frequencies.add(currentFrequency());
+            int ready = ::poll(&result, 1, samplePeriodMs);
+            if (ready < 0 && errno != EINTR)
+                break;
+            if (ready <= 0)
+                continue;
+            ssize_t n = ::read(fds[0], buffer, sizeof(buffer));
+            if (n <= 0)
+                break;
+            stream.write(buffer, n);
+        }
+        frequencies.add(currentFrequency());
+        ::close(fds[0]);
+
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+#else
+    bool runChild(Suite suite, std::ostream& stream, FrequencyRange& frequencies)
+    {
+        frequencies.add(currentFrequency());
+        suite(stream);
+        frequencies.add(currentFrequency());
+        return true;
+    }
+#endif
+
+    int _cpu;
+    std::vector<Suite> _suites;
+};
@@ -1,4 +1,6 @@
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
 #include <string>
@@ -9,6 +11,14 @@
 #include <list>
 #include <deque>
 #include <forward_list>
+#include <algorithm>
+
+#include "skip_list.hpp"
+#include "pod_vector.hpp"
+#include "isolated_runner.hpp"
+// thread_introduction's AVX2 quicksort (--sort simd), found through
+// -I../../thread_introduction
+#include "simd_sort.hpp"
 
 struct ContainerTest
 {
@@ -17,6 +27,9 @@ public:
     using time_point = std::chrono::time_point<chrono>;
     static const size_t nb_element = 10000;
     static const size_t nb_loop = 5;
+    static const size_t nb_search = 100;
+    // --sort simd: contiguous uint32_t containers are sorted by simdSort
+    static bool useSimdSort;
 
     enum Method
     {
@@ -39,6 +52,11 @@ public:
         ACCESS_RANDOM,
         CLEAR,
         SORT,
+        INSERT_RANGE,
+        ERASE_RANGE,
+        ERASE_IF,
+        FIND,
+        COUNT,
         MAX
     };
 
@@ -82,6 +100,16 @@ public:
         duration(time, Method::SORT);
     }
 
+    void sort(std::vector<uint32_t>& container)
+    {
+        contiguous_sort(container.data(), container.size());
+    }
+
+    void sort(PodVector<uint32_t>& container)
+    {
+        contiguous_sort(container.data(), container.size());
+    }
+
     template <class Container>
     void list_sort(Container& container)
     {
@@ -241,6 +269,17 @@ public:
         duration(time, Method::ERASE_BACK);
     }
 
+    void erase_back(PodVector<uint32_t>& container)
+    {
+        auto time = chrono::now();
+        while (!container.empty())
+        {
+            container.erase(container.end() - 1);
+        }
+
+        duration(time, Method::ERASE_BACK);
+    }
+
     template <class Container>
     void erase_front(Container& container)
     {
@@ -322,6 +361,122 @@ public:
         duration(time, Method::ACCESS_RANDOM);
     }
 
+    template <class Container>
+    void insert_range(Container& container)
+    {
+        std::vector<uint32_t> range(nb_element);
+        for (auto& nb : range)
+            nb = _generator();
+
+        auto time = chrono::now();
+        container.insert(it_increment(container.begin(), nb_element / 2), range.begin(), range.end());
+        duration(time, Method::INSERT_RANGE);
+    }
+
+    void insert_range(std::forward_list<uint32_t>& container)
+    {
+        std::vector<uint32_t> range(nb_element);
+        for (auto& nb : range)
+            nb = _generator();
+
+        auto time = chrono::now();
+        container.insert_after(it_increment(container.before_begin(), nb_element / 2), range.begin(), range.end());
+        duration(time, Method::INSERT_RANGE);
+    }
+
+    // Erase the middle half of a container holding at least nb_element values
+    template <class Container>
+    void erase_range(Container& container)
+    {
+        auto time = chrono::now();
+        auto first = it_increment(container.begin(), nb_element / 4);
+        auto last = it_increment(container.begin(), nb_element * 3 / 4);
+        container.erase(first, last);
+        duration(time, Method::ERASE_RANGE);
+    }
+
+    void erase_range(std::forward_list<uint32_t>& container)
+    {
+        auto time = chrono::now();
+        auto first = it_increment(container.before_begin(), nb_element / 4);
+        auto last = it_increment(container.before_begin(), nb_element * 3 / 4 + 1);
+        container.erase_after(first, last);
+        duration(time, Method::ERASE_RANGE);
+    }
+
+    template <class Container>
+    void erase_if(Container& container)
+    {
+        auto time = chrono::now();
+        container.erase(std::remove_if(container.begin(), container.end(), isOdd), container.end());
+        duration(time, Method::ERASE_IF);
+    }
+
+    template <class Container>
+    void remove_if(Container& container)
+    {
+        auto time = chrono::now();
+        container.remove_if(isOdd);
+        duration(time, Method::ERASE_IF);
+    }
+
+    // its branchless compaction
+    void erase_if(PodVector<uint32_t>& container)
+    {
+        remove_if(container);
+    }
+
+    // Random values are almost never in the container: every search is a full scan
+    template <class Container>
+    void find(Container& container)
+    {
+        std::mt19937 random(42);
+
+        auto time = chrono::now();
+        for (size_t i = 0; i < nb_search; ++i)
+        {
+            _total += std::find(container.begin(), container.end(), random()) != container.end();
+        }
+        duration(time, Method::FIND);
+    }
+
+    void find(PodVector<uint32_t>& container)
+    {
+        std::mt19937 random(42);
+
+        auto time = chrono::now();
+        for (size_t i = 0; i < nb_search; ++i)
+        {
+            _total += container.find(random()) != container.end();
+        }
+        duration(time, Method::FIND);
+    }
+
+    template <class Container>
+    void count(Container& container)
+    {
+        std::mt19937 random(42);
+
+        auto time = chrono::now();
+        for (size_t i = 0; i < nb_search; ++i)
+        {
+            _total += std::count(container.begin(), container.end(), random());
+        }
+        duration(time, Method::COUNT);
+    }
+
+    void count(PodVector<uint32_t>& container)
+    {
+        std::mt19937 random(42);
+
+        auto time = chrono::now();
+        for (size_t i = 0; i < nb_search; ++i)
+        {
+            _total += container.count(random());
+        }
+        duration(time, Method::COUNT);
+    }
+
     template <class Container>
     void clear(Container& container)
     {
@@ -359,6 +514,11 @@ public:
         stream << std::setw(12) << "access_rand";
         stream << std::setw(12) << "clear";
         stream << std::setw(12) << "sort";
+        stream << std::setw(12) << "ins_range";
+        stream << std::setw(12) << "erase_range";
+        stream << std::setw(12) << "erase_if";
+        stream << std::setw(12) << "find";
+        stream << std::setw(12) << "count";
         stream << std::endl;
     }
 
@@ -385,6 +545,21 @@ public:
     }
 
 private:
+    void contiguous_sort(uint32_t* data, size_t size)
+    {
+        auto time = chrono::now();
+        if (useSimdSort)
+            simdSort(data, data + size);
+        else
+            std::sort(data, data + size);
+        duration(time, Method::SORT);
+    }
+
+    static bool isOdd(uint32_t nb)
+    {
+        return (nb & 1) != 0;
+    }
+
     template <typename T_Iterator>
     T_Iterator it_increment(T_Iterator it, size_t value)
     {
@@ -418,10 +593,15 @@ private:
     std::mt19937 _generator;
 };
 
-void test_vector(std::ostream& stream)
+bool ContainerTest::useSimdSort = false;
+
+// Suite of the contiguous containers: ContainerTest overloads pick the
+// members of PodVector (sort, find, count, remove_if) where it has its own
+template <class Container>
+void test_contiguous(std::ostream& stream, char const* name)
 {
-    ContainerTest containerTest("vector");
-    std::vector<uint32_t> container;
+    ContainerTest containerTest(name);
+    Container container;
 
     for (size_t i = 0; i < ContainerTest::nb_loop; ++i)
     {
@@ -494,12 +674,31 @@ void test_vector(std::ostream& stream)
         containerTest.avoidCompilerOptimization(container);
         containerTest.sort(container);
 
+        // Test find
+        containerTest.find(container);
+        // Test count
+        containerTest.count(container);
+
+        // Test insert_range
+        container.clear();
+        containerTest.push_back(container);
+        containerTest.insert_range(container);
+        // Test erase_range
+        containerTest.erase_range(container);
+        // Test erase_if
+        containerTest.erase_if(container);
+
         container.clear();
     }
 
     containerTest.writeResult(stream);
 }
 
+void test_vector(std::ostream& stream)
+{
+    test_contiguous<std::vector<uint32_t>>(stream, "vector");
+}
+
 void test_list(std::ostream& stream)
 {
     ContainerTest containerTest("list");
@@ -558,6 +757,20 @@ void test_list(std::ostream& stream)
         containerTest.push_back(container);
         containerTest.list_sort(container);
 
+        // Test find
+        containerTest.find(container);
+        // Test count
+        containerTest.count(container);
+
+        // Test insert_range
+        container.clear();
+        containerTest.push_back(container);
+        containerTest.insert_range(container);
+        // Test erase_range
+        containerTest.erase_range(container);
+        // Test erase_if
+        containerTest.remove_if(container);
+
         container.clear();
     }
 
@@ -622,6 +835,20 @@ void test_deque(std::ostream& stream)
         containerTest.push_back(container);
         containerTest.sort(container);
 
+        // Test find
+        containerTest.find(container);
+        // Test count
+        containerTest.count(container);
+
+        // Test insert_range
+        container.clear();
+        containerTest.push_back(container);
+        containerTest.insert_range(container);
+        // Test erase_range
+        containerTest.erase_range(container);
+        // Test erase_if
+        containerTest.erase_if(container);
+
         container.clear();
     }
 
@@ -667,20 +894,173 @@ void test_forward_list(std::ostream& stream)
         containerTest.push_front(container);
         containerTest.list_sort(container);
 
+        // Test find
+        containerTest.find(container);
+        // Test count
+        containerTest.count(container);
+
+        // Test insert_range
+        container.clear();
+        containerTest.push_front(container);
+        containerTest.insert_range(container);
+        // Test erase_range
+        containerTest.erase_range(container);
+        // Test erase_if
+        containerTest.remove_if(container);
+
+        container.clear();
+    }
+
+    containerTest.writeResult(stream);
+}
+
+void test_pod_vector(std::ostream& stream)
+{
+    test_contiguous<PodVector<uint32_t>>(stream, "pod_vector");
+}
+
+void test_skip_list(std::ostream& stream)
+{
+    ContainerTest containerTest("skip_list");
+    SkipList<uint32_t> container;
+
+    for (size_t i = 0; i < ContainerTest::nb_loop; ++i)
+    {
+        // Test push_back
+        containerTest.push_back(container);
+        containerTest.avoidCompilerOptimization(container);
+        // Test push_front
+        container.clear();
+        containerTest.push_front(container);
+        containerTest.avoidCompilerOptimization(container);
+
+        // Test insert_back
+        container.clear();
+        containerTest.insert_back(container);
+        containerTest.avoidCompilerOptimization(container);
+        // Test insert_front
+        container.clear();
+        containerTest.insert_front(container);
+        containerTest.avoidCompilerOptimization(container);
+        // Test insert_random
+        container.clear();
+        containerTest.insert_random(container);
+        containerTest.avoidCompilerOptimization(container);
+
+        // Test pop_front
+        containerTest.pop_front(container);
+        // Test pop_back
+        containerTest.push_back(container);
+        containerTest.pop_back(container);
+
+        // Test erase_back
+        containerTest.push_back(container);
+        containerTest.erase_back(container);
+        // Test erase_front
+        containerTest.push_back(container);
+        containerTest.erase_front(container);
+        // Test erase_random
+        containerTest.push_back(container);
+        containerTest.erase_random(container);
+
+        // Test access_continuous
+        containerTest.push_back(container);
+        containerTest.access_continuous(container);
+        // Test access_random
+        containerTest.access_random(container);
+
+        // Test clear
+        containerTest.clear(container);
+
+        // Test sort
+        container.clear();
+        containerTest.push_back(container);
+        containerTest.list_sort(container);
+
+        // Test find
+        containerTest.find(container);
+        // Test count
+        containerTest.count(container);
+
+        // Test insert_range
+        container.clear();
+        containerTest.push_back(container);
+        containerTest.insert_range(container);
+        // Test erase_range
+        containerTest.erase_range(container);
+        // Test erase_if
+        containerTest.remove_if(container);
+
         container.clear();
     }
 
     containerTest.writeResult(stream);
 }
 
-int main(int, char**)
+// Usage: main [--isolated [cpu]] [--sort std|simd]
+//   --isolated: run each container in a forked child pinned to cpu (default 0)
+//   --sort: SORT of vector and pod_vector with std::sort (default) or the
+//           AVX2 simdSort, std::sort on CPUs without AVX2
+int main(int argc, char** argv)
 {
     std::ostream& stream = std::cout;
+    bool isolated = false;
+    int cpu = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--isolated")
+        {
+            isolated = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+            {
+                char const* value = argv[++i];
+                char* end = nullptr;
+                long parsed = std::strtol(value, &end, 10);
+                if (end == value || *end != '\0' || !IsolatedRunner::validCpu(parsed))
+                {
+                    std::cerr << "invalid cpu " << value << std::endl;
+                    return 1;
+                }
+                cpu = static_cast<int>(parsed);
+            }
+        }
+        else if (arg == "--sort" && i + 1 < argc)
+        {
+            std::string engine = argv[++i];
+            if (engine != "std" && engine != "simd")
+            {
+                std::cerr << "unknown sort " << engine << std::endl;
+                return 1;
+            }
+            ContainerTest::useSimdSort = engine == "simd";
+        }
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--isolated [cpu]] [--sort std|simd]" << std::endl;
+            return 1;
+        }
+    }
 
     ContainerTest::writeHeader(stream);
+    if (isolated)
+    {
+        IsolatedRunner runner(cpu);
+        runner.add(test_vector);
+        runner.add(test_list);
+        runner.add(test_deque);
+        runner.add(test_forward_list);
+        runner.add(test_skip_list);
+        runner.add(test_pod_vector);
+        return runner.run(stream) ? 0 : 2;
+    }
+
     test_vector(stream);
     test_list(stream);
     test_deque(stream);
     test_forward_list(stream);
+    test_skip_list(stream);
+    test_pod_vector(stream);
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,303 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <iterator>
+#include <algorithm>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Vectorised search kernels on uint32_t, scalar versions for any other POD.
+namespace pod_simd
+{
+    template <typename T>
+    T const* find(T const* first, T const* last, T const& value)
+    {
+        for (; first != last; ++first)
+        {
+            if (*first == value)
+                return first;
+        }
+        return last;
+    }
+
+    template <typename T>
+    size_t count(T const* first, T const* last, T const& value)
+    {
+        size_t result = 0;
+        for (; first != last; ++first)
+            result += (*first == value);
+        return result;
+    }
+
+#if defined(__AVX2__)
+    inline uint32_t const* find(uint32_t const* first, uint32_t const* last, uint32_t const& value)
+    {
+        __m256i const needle = _mm256_set1_epi32(static_cast<int>(value));
+        for (; last - first >= 8; first += 8)
+        {
+            __m256i const block = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(first));
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(block, needle))));
+            if (mask != 0)
+                return first + __builtin_ctz(mask);
+        }
+        return find<uint32_t>(first, last, value);
+    }
+
+    inline size_t count(uint32_t const* first, uint32_t const* last, uint32_t const& value)
+    {
+        __m256i const needle = _mm256_set1_epi32(static_cast<int>(value));
+        size_t result = 0;
+        while (last - first >= 8)
+        {
+            // lanes are 32 bits wide, flush them before they can overflow
+            uint32_t const* blockEnd = first + (std::min<size_t>((last - first) / 8, 1u << 30) * 8);
+            __m256i lanes = _mm256_setzero_si256();
+            for (; first != blockEnd; first += 8)
+            {
+                __m256i const block = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(first));
+                lanes = _mm256_sub_epi32(lanes, _mm256_cmpeq_epi32(block, needle));
+            }
+            alignas(32) uint32_t sums[8];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(sums), lanes);
+            for (auto sum : sums)
+                result += sum;
+        }
+        return result + count<uint32_t>(first, last, value);
+    }
+#elif defined(__SSE2__)
+    inline uint32_t const* find(uint32_t const* first, uint32_t const* last, uint32_t const& value)
+    {
+        __m128i const needle = _mm_set1_epi32(static_cast<int>(value));
+        for (; last - first >= 4; first += 4)
+        {
+            __m128i const block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(first));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(block, needle))));
+            if (mask != 0)
+                return first + __builtin_ctz(mask);
+        }
+        return find<uint32_t>(first, last, value);
+    }
+
+    inline size_t count(uint32_t const* first, uint32_t const* last, uint32_t const& value)
+    {
+        __m128i const needle = _mm_set1_epi32(static_cast<int>(value));
+        size_t result = 0;
+        while (last - first >= 4)
+        {
+            // lanes are 32 bits wide, flush them before they can overflow
+            uint32_t const* blockEnd = first + (std::min<size_t>((last - first) / 4, 1u << 30) * 4);
+            __m128i lanes = _mm_setzero_si128();
+            for (; first != blockEnd; first += 4)
+            {
+                __m128i const block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(first));
+                lanes = _mm_sub_epi32(lanes, _mm_cmpeq_epi32(block, needle));
+            }
+            alignas(16) uint32_t sums[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(sums), lanes);
+            for (auto sum : sums)
+                result += sum;
+        }
+        return result + count<uint32_t>(first, last, value);
+    }
+#endif
+}
+
+// Vector restricted to PODs: storage is managed with malloc/realloc and
+// elements are moved with memmove, no constructor or destructor is ever run.
+template <typename T>
+class PodVector
+{
+    static_assert(std::is_trivially_copyable<T>::value, "PodVector only holds PODs");
+
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using iterator = T*;
+    using const_iterator = T const*;
+
+    PodVector() = default;
+
+    PodVector(PodVector const& other)
+    {
+        // memcpy from the null data of an empty vector is undefined
+        if (other._size)
+        {
+            reserve(other._size);
+            ::memcpy(_data, other._data, other._size * sizeof(T));
+            _size = other._size;
+        }
+    }
+
+    PodVector& operator=(PodVector const& other)
+    {
+        if (this != &other)
+        {
+            _size = 0;
+            if (other._size)
+            {
+                reserve(other._size);
+                ::memcpy(_data, other._data, other._size * sizeof(T));
+                _size = other._size;
+            }
+        }
+        return *this;
+    }
+
+    ~PodVector()
+    {
+        ::free(_data);
+    }
+
+    size_t size() const { return _size; }
+    size_t capacity() const { return _capacity; }
+    bool empty() const { return _size == 0; }
+
+    T* data() { return _data; }
+    T const* data() const { return _data; }
+    iterator begin() { return _data; }
+    iterator end() { return _data + _size; }
+    const_iterator begin() const { return _data; }
+    const_iterator end() const { return _data + _size; }
+
+    T& operator[](size_t pos) { return _data[pos]; }
+    T const& operator[](size_t pos) const { return _data[pos]; }
+    T& front() { return _data[0]; }
+    T& back() { return _data[_size - 1]; }
+
+    void reserve(size_t capacity)
+    {
+        if (capacity <= _capacity)
+            return;
+        T* data = static_cast<T*>(::realloc(_data, capacity * sizeof(T)));
+        if (!data)
+            throw std::bad_alloc();
+        _data = data;
+        _capacity = capacity;
+    }
+
+    void shrink_to_fit()
+    {
+        if (_size == 0)
+        {
+            ::free(_data);
+            _data = nullptr;
+            _capacity = 0;
+        }
+        else if (_size < _capacity)
+        {
+            // a failed shrink keeps the larger block
+            T* data = static_cast<T*>(::realloc(_data, _size * sizeof(T)));
+            if (!data)
+                return;
+            _data = data;
+            _capacity = _size;
+        }
+    }
+
+    void clear() { _size = 0; }
+
+    void push_back(T const& value)
+    {
+        if (_size == _capacity)
+            grow(_size + 1);
+        _data[_size++] = value;
+    }
+
+    void push_front(T const& value)
+    {
+        insert(begin(), value);
+    }
+
+    void pop_back() { --_size; }
+
+    void pop_front()
+    {
+        erase(begin());
+    }
+
+    iterator insert(const_iterator pos, T const& value)
+    {
+        size_t index = pos - _data;
+        T copy = value;
+        if (_size == _capacity)
+            grow(_size + 1);
+        ::memmove(_data + index + 1, _data + index, (_size - index) * sizeof(T));
+        _data[index] = copy;
+        ++_size;
+        return _data + index;
+    }
+
+    template <typename InputIt>
+    iterator insert(const_iterator pos, InputIt first, InputIt last)
+    {
+        size_t index = pos - _data;
+        size_t count = static_cast<size_t>(std::distance(first, last));
+        if (_size + count > _capacity)
+            grow(_size + count);
+        ::memmove(_data + index + count, _data + index, (_size - index) * sizeof(T));
+        T* out = _data + index;
+        for (; first != last; ++first)
+            *out++ = *first;
+        _size += count;
+        return _data + index;
+    }
+
+    iterator erase(const_iterator pos)
+    {
+        return erase(pos, pos + 1);
+    }
+
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        size_t index = first - _data;
+        size_t count = last - first;
+        ::memmove(_data + index, last, (end() - last) * sizeof(T));
+        _size -= count;
+        return _data + index;
+    }
+
+    const_iterator find(T const& value) const
+    {
+        return pod_simd::find(begin(), end(), value);
+    }
+
+    size_t count(T const& value) const
+    {
+        return pod_simd::count(begin(), end(), value);
+    }
+
+    // Branchless compaction: every element is written, the output cursor
+    // only moves for the kept ones, so random predicates cost no mispredict.
+    template <typename Predicate>
+    size_t remove_if(Predicate pred)
+    {
+        T* out = _data;
+        for (T const* it = _data; it != _data + _size; ++it)
+        {
+            T const value = *it;
+            *out = value;
+            out += !pred(value);
+        }
+        size_t removed = end() - out;
+        _size = out - _data;
+        return removed;
+    }
+
+private:
+    void grow(size_t minimum)
+    {
+        size_t capacity = _capacity ? _capacity * 2 : 16;
+        reserve(capacity < minimum ? minimum : capacity);
+    }
+
+    T* _data = nullptr;
+    size_t _size = 0;
+    size_t _capacity = 0;
+};
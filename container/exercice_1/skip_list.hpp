@@ -0,0 +1,414 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <algorithm>
+
+// Indexable skip list: every link stores its width (the number of positions
+// it jumps over), so operator[], insert(pos) and erase(pos) are O(log n).
+// Nodes are never moved, iterators stay valid until their element is erased.
+//
+// Ranks: the head sentinel has rank 0, element i has rank i + 1 and the tail
+// sentinel (end()) has rank size() + 1. Every level of the head ends on the
+// tail, so a search never has to deal with null links.
+template <typename T, size_t MaxLevel = 16>
+class SkipList
+{
+    struct Node;
+
+    struct Link
+    {
+        Node* next;
+        size_t width;
+    };
+
+    struct Node
+    {
+        T value;
+        Node* prev;
+        size_t height;
+        Link links[1];
+    };
+
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using reference = T&;
+    using const_reference = T const&;
+
+    template <typename U>
+    class basic_iterator
+    {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = U*;
+        using reference = U&;
+
+        basic_iterator() = default;
+        explicit basic_iterator(Node* node) : _node(node) {}
+
+        // iterator to const_iterator only
+        template <typename V, std::enable_if_t<std::is_same<U, T const>::value && std::is_same<V, T>::value, int> = 0>
+        basic_iterator(basic_iterator<V> const& other) : _node(other._node) {}
+
+        reference operator*() const { return _node->value; }
+        pointer operator->() const { return &_node->value; }
+
+        basic_iterator& operator++()
+        {
+            _node = _node->links[0].next;
+            return *this;
+        }
+
+        basic_iterator operator++(int)
+        {
+            auto tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        basic_iterator& operator--()
+        {
+            _node = _node->prev;
+            return *this;
+        }
+
+        basic_iterator operator--(int)
+        {
+            auto tmp = *this;
+            --*this;
+            return tmp;
+        }
+
+        // Finger search: always take the highest link that does not overshoot,
+        // expected O(log n) instead of n calls to operator++.
+        basic_iterator operator+(size_t n) const
+        {
+            Node* node = _node;
+            while (n > 0)
+            {
+                size_t level = node->height - 1;
+                while (node->links[level].width > n)
+                    --level;
+                n -= node->links[level].width;
+                node = node->links[level].next;
+            }
+            return basic_iterator(node);
+        }
+
+        bool operator==(basic_iterator const& other) const { return _node == other._node; }
+        bool operator!=(basic_iterator const& other) const { return _node != other._node; }
+
+    private:
+        template <typename V> friend class basic_iterator;
+        friend class SkipList;
+
+        Node* _node = nullptr;
+    };
+
+    using iterator = basic_iterator<T>;
+    using const_iterator = basic_iterator<T const>;
+
+    SkipList()
+        : _head(allocateNode(MaxLevel))
+        , _tail(allocateNode(MaxLevel))
+    {
+        _head->prev = nullptr;
+        _tail->prev = _head;
+        for (size_t level = 0; level < MaxLevel; ++level)
+        {
+            _head->links[level] = Link{_tail, 1};
+            _tail->links[level] = Link{nullptr, 0};
+        }
+    }
+
+    SkipList(SkipList const& other)
+        : SkipList()
+    {
+        for (auto const& value : other)
+            push_back(value);
+    }
+
+    SkipList& operator=(SkipList const& other)
+    {
+        if (this != &other)
+        {
+            clear();
+            for (auto const& value : other)
+                push_back(value);
+        }
+        return *this;
+    }
+
+    ~SkipList()
+    {
+        clear();
+        ::free(_head);
+        ::free(_tail);
+    }
+
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+    iterator begin() { return iterator(_head->links[0].next); }
+    iterator end() { return iterator(_tail); }
+    const_iterator begin() const { return const_iterator(_head->links[0].next); }
+    const_iterator end() const { return const_iterator(_tail); }
+
+    T& front() { return _head->links[0].next->value; }
+    T& back() { return _tail->prev->value; }
+
+    T& operator[](size_t pos) { return findRank(pos + 1)->value; }
+    T const& operator[](size_t pos) const { return findRank(pos + 1)->value; }
+
+    // Position of an element, climbs to the tail with the highest links.
+    size_t index_of(const_iterator it) const
+    {
+        size_t distance = 0;
+        for (Node* node = it._node; node != _tail; )
+        {
+            Link const& link = node->links[node->height - 1];
+            distance += link.width;
+            node = link.next;
+        }
+        return _size - distance;
+    }
+
+    iterator insert(size_t pos, T const& value)
+    {
+        Node* update[MaxLevel];
+        size_t rank[MaxLevel];
+        size_t const target = pos + 1;
+
+        findPredecessors(target, update, rank);
+
+        size_t height = randomHeight();
+        Node* node = allocateNode(height);
+        new (&node->value) T(value);
+
+        for (size_t level = 0; level < height; ++level)
+        {
+            Link& link = update[level]->links[level];
+            node->links[level] = Link{link.next, rank[level] + link.width + 1 - target};
+            link = Link{node, target - rank[level]};
+        }
+        for (size_t level = height; level < MaxLevel; ++level)
+            ++update[level]->links[level].width;
+
+        node->prev = update[0];
+        node->links[0].next->prev = node;
+        if (height > _level)
+            _level = height;
+        ++_size;
+        return iterator(node);
+    }
+
+    iterator insert(const_iterator it, T const& value)
+    {
+        return insert(index_of(it), value);
+    }
+
+    iterator erase(size_t pos)
+    {
+        Node* update[MaxLevel];
+        size_t rank[MaxLevel];
+
+        findPredecessors(pos + 1, update, rank);
+
+        Node* node = update[0]->links[0].next;
+        for (size_t level = 0; level < node->height; ++level)
+        {
+            Link& link = update[level]->links[level];
+            link = Link{node->links[level].next, link.width + node->links[level].width - 1};
+        }
+        for (size_t level = node->height; level < MaxLevel; ++level)
+            --update[level]->links[level].width;
+
+        Node* next = node->links[0].next;
+        next->prev = update[0];
+        destroyNode(node);
+        --_size;
+        return iterator(next);
+    }
+
+    iterator erase(const_iterator it)
+    {
+        return erase(index_of(it));
+    }
+
+    template <typename InputIt>
+    iterator insert(const_iterator it, InputIt first, InputIt last)
+    {
+        size_t pos = index_of(it);
+        size_t const begin = pos;
+        for (; first != last; ++first)
+            insert(pos++, *first);
+        return this->begin() + begin;
+    }
+
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        size_t pos = index_of(first);
+        for (size_t count = index_of(last) - pos; count > 0; --count)
+            erase(pos);
+        return begin() + pos;
+    }
+
+    // Single pass: relink the kept nodes level by level, widths are rebuilt
+    // from the new ranks, so this is O(n) instead of O(k log n).
+    template <typename Predicate>
+    size_t remove_if(Predicate pred)
+    {
+        Node* last[MaxLevel];
+        size_t lastRank[MaxLevel];
+        size_t rank = 0;
+
+        for (size_t level = 0; level < MaxLevel; ++level)
+        {
+            last[level] = _head;
+            lastRank[level] = 0;
+        }
+
+        Node* node = _head->links[0].next;
+        while (node != _tail)
+        {
+            Node* next = node->links[0].next;
+            if (pred(node->value))
+                destroyNode(node);
+            else
+            {
+                ++rank;
+                node->prev = last[0];
+                for (size_t level = 0; level < node->height; ++level)
+                {
+                    last[level]->links[level] = Link{node, rank - lastRank[level]};
+                    last[level] = node;
+                    lastRank[level] = rank;
+                }
+            }
+            node = next;
+        }
+
+        for (size_t level = 0; level < MaxLevel; ++level)
+            last[level]->links[level] = Link{_tail, rank + 1 - lastRank[level]};
+        _tail->prev = last[0];
+
+        size_t removed = _size - rank;
+        _size = rank;
+        return removed;
+    }
+
+    void push_back(T const& value) { insert(_size, value); }
+    void push_front(T const& value) { insert(size_t(0), value); }
+    void pop_back() { erase(_size - 1); }
+    void pop_front() { erase(size_t(0)); }
+
+    void clear()
+    {
+        Node* node = _head->links[0].next;
+        while (node != _tail)
+        {
+            Node* next = node->links[0].next;
+            destroyNode(node);
+            node = next;
+        }
+        for (size_t level = 0; level < MaxLevel; ++level)
+            _head->links[level] = Link{_tail, 1};
+        _tail->prev = _head;
+        _size = 0;
+        _level = 1;
+    }
+
+    // The link structure only depends on positions, so sorting moves the
+    // values and keeps every node (and iterator) in place.
+    void sort()
+    {
+        std::vector<T> values(begin(), end());
+        std::sort(values.begin(), values.end());
+        auto it = values.begin();
+        for (auto& value : *this)
+            value = std::move(*it++);
+    }
+
+private:
+    static Node* allocateNode(size_t height)
+    {
+        void* memory = ::malloc(sizeof(Node) + (height - 1) * sizeof(Link));
+        if (!memory)
+            throw std::bad_alloc();
+        Node* node = static_cast<Node*>(memory);
+        node->height = height;
+        return node;
+    }
+
+    static void destroyNode(Node* node)
+    {
+        node->value.~T();
+        ::free(node);
+    }
+
+    Node* findRank(size_t target) const
+    {
+        Node* node = _head;
+        size_t rank = 0;
+        for (size_t level = _level; level-- > 0; )
+        {
+            while (rank + node->links[level].width <= target)
+            {
+                rank += node->links[level].width;
+                node = node->links[level].next;
+            }
+        }
+        return node;
+    }
+
+    // For each level, last node whose rank is strictly lower than target.
+    void findPredecessors(size_t target, Node** update, size_t* rank) const
+    {
+        Node* node = _head;
+        size_t current = 0;
+        for (size_t level = MaxLevel; level-- > 0; )
+        {
+            if (level < _level)
+            {
+                while (current + node->links[level].width < target)
+                {
+                    current += node->links[level].width;
+                    node = node->links[level].next;
+                }
+            }
+            update[level] = node;
+            rank[level] = current;
+        }
+    }
+
+    // Geometric distribution with p = 1/4.
+    size_t randomHeight()
+    {
+        size_t height = 1;
+        while (height < MaxLevel)
+        {
+            _seed ^= _seed << 13;
+            _seed ^= _seed >> 17;
+            _seed ^= _seed << 5;
+            if ((_seed & 3) != 0)
+                break;
+            ++height;
+        }
+        return height;
+    }
+
+    Node* _head;
+    Node* _tail;
+    size_t _size = 0;
+    size_t _level = 1;
+    uint32_t _seed = 2463534242;
+};
@@ -0,0 +1,76 @@
+#include <algorithm>
+
+#include "core/pentamino.hpp"
+
+namespace
+{
+    std::vector<Cell> normalized(std::vector<Cell> cells)
+    {
+        int minX = cells[0].x;
+        int minY = cells[0].y;
+        for (auto const& cell : cells)
+        {
+            minX = std::min(minX, cell.x);
+            minY = std::min(minY, cell.y);
+        }
+        for (auto& cell : cells)
+        {
+            cell.x -= minX;
+            cell.y -= minY;
+        }
+        std::sort(cells.begin(), cells.end());
+        return cells;
+    }
+}
+
+Pentamino::Pentamino(char name, std::vector<std::string> const& rows)
+: _name(name)
+{
+    std::vector<Cell> cells;
+    for (size_t y = 0; y < rows.size(); ++y)
+    {
+        for (size_t x = 0; x < rows[y].size(); ++x)
+        {
+            if (rows[y][x] == 'X')
+                cells.push_back(Cell{int(x), int(y)});
+        }
+    }
+
+    // 4 rotations of the piece, then of its mirror image
+    for (int mirror = 0; mirror < 2; ++mirror)
+    {
+        std::vector<Cell> shape = cells;
+        if (mirror)
+        {
+            for (auto& cell : shape)
+                cell.x = -cell.x;
+        }
+        for (int rotation = 0; rotation < 4; ++rotation)
+        {
+            for (auto& cell : shape)
+                cell = Cell{cell.y, -cell.x};
+            std::vector<Cell> orientation = normalized(shape);
+            if (std::find(_orientations.begin(), _orientations.end(), orientation) == _orientations.end())
+                _orientations.push_back(orientation);
+        }
+    }
+}
+
+std::vector<Pentamino> const& Pentamino::all()
+{
+    static std::vector<Pentamino> const pieces{
+        Pentamino('F', {".XX", "XX.", ".X."}),
+        Pentamino('I', {"XXXXX"}),
+        Pentamino('L', {"X...", "XXXX"}),
+        Pentamino('N', {"XX..", ".XXX"}),
+        Pentamino('P', {"XX", "XX", "X."}),
+        Pentamino('T', {"XXX", ".X.", ".X."}),
+        Pentamino('U', {"X.X", "XXX"}),
+        Pentamino('V', {"X..", "X..", "XXX"}),
+        Pentamino('W', {"X..", "XX.", ".XX"}),
+        Pentamino('X', {".X.", "XXX", ".X."}),
+        Pentamino('Y', {".X..", "XXXX"}),
+        Pentamino('Z', {"XX.", ".X.", ".XX"}),
+    };
+    return pieces;
+}
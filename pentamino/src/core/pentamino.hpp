@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A cell of a piece or of the board, x to the right and y down
+struct Cell
+{
+    int x;
+    int y;
+
+    bool operator<(Cell const& other) const
+    {
+        return y < other.y || (y == other.y && x < other.x);
+    }
+
+    bool operator==(Cell const& other) const
+    {
+        return x == other.x && y == other.y;
+    }
+};
+
+// One of the 12 pentaminos, named by its usual letter
+class Pentamino
+{
+public:
+    static const unsigned nbCells = 5;
+
+    // rows of 'X' for the cells of the piece, '.' elsewhere
+    Pentamino(char name, std::vector<std::string> const& rows);
+
+    char name() const { return _name; }
+
+    // The distinct shapes of the piece under rotations and reflections (1 to
+    // 8), each with its cells sorted and moved to x >= 0, y >= 0 against
+    // both axes
+    std::vector<std::vector<Cell>> const& orientations() const { return _orientations; }
+
+    // The 12 pieces, F I L N P T U V W X Y Z
+    static std::vector<Pentamino> const& all();
+
+private:
+    char _name;
+    std::vector<std::vector<Cell>> _orientations;
+};
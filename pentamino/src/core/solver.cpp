@@ -0,0 +1,182 @@
+#include <algorithm>
+
+#include "core/solver.hpp"
+#include "utils/bitfu.hpp"
+
+const unsigned PentaminoSolver::width;
+const unsigned PentaminoSolver::height;
+const unsigned PentaminoSolver::nbCells;
+const unsigned PentaminoSolver::nbPieces;
+const uint64_t PentaminoSolver::emptyBoard;
+
+namespace
+{
+    uint64_t cellBit(unsigned x, unsigned y)
+    {
+        return uint64_t(1) << (x * PentaminoSolver::height + y);
+    }
+
+    // cells of row y
+    constexpr uint64_t rowMask(unsigned y)
+    {
+        uint64_t mask = 0;
+        for (unsigned x = 0; x < PentaminoSolver::width; ++x)
+            mask |= uint64_t(1) << (x * PentaminoSolver::height + y);
+        return mask;
+    }
+
+    // An empty cell with no empty neighbour can never be covered
+    inline bool hasIsolatedCell(uint64_t board)
+    {
+        constexpr uint64_t topRow = rowMask(0);
+        constexpr uint64_t bottomRow = rowMask(PentaminoSolver::height - 1);
+        uint64_t const empty = ~board;
+        uint64_t const withEmptyNeighbour = ((empty << 1) & ~topRow) | ((empty >> 1) & ~bottomRow)
+                                          | (empty << PentaminoSolver::height) | (empty >> PentaminoSolver::height);
+        return (empty & ~withEmptyNeighbour) != 0;
+    }
+}
+
+PentaminoSolver::PentaminoSolver()
+: _xPiece(0)
+, _first()
+, _stack()
+, _count(0)
+{
+    std::array<std::array<std::vector<uint64_t>, nbPieces>, nbCells> byCell;
+    auto const& pieces = Pentamino::all();
+    for (size_t piece = 0; piece < pieces.size(); ++piece)
+    {
+        bool const isX = pieces[piece].name() == 'X';
+        if (isX)
+            _xPiece = uint8_t(piece);
+        for (auto const& orientation : pieces[piece].orientations())
+        {
+            int sizeX = 0;
+            int sizeY = 0;
+            for (auto const& cell : orientation)
+            {
+                sizeX = std::max(sizeX, cell.x + 1);
+                sizeY = std::max(sizeY, cell.y + 1);
+            }
+
+            for (int y = 0; y + sizeY <= int(height); ++y)
+            {
+                for (int x = 0; x + sizeX <= int(width); ++x)
+                {
+                    uint64_t mask = 0;
+                    for (auto const& cell : orientation)
+                        mask |= cellBit(unsigned(x + cell.x), unsigned(y + cell.y));
+                    if (!isX)
+                    {
+                        byCell[lowest_bit_index(mask)][piece].push_back(mask);
+                        continue;
+                    }
+                    _xAll.push_back(mask);
+                    // the centre of the X is at x + 1, y + 1, never on an
+                    // axis of the board whose sides are even
+                    if (2 * (x + 1) < int(width) && 2 * (y + 1) < int(height))
+                        _xDistinct.push_back(mask);
+                }
+            }
+        }
+    }
+
+    for (unsigned cell = 0; cell < nbCells; ++cell)
+    {
+        for (unsigned piece = 0; piece < nbPieces; ++piece)
+        {
+            _first[cell][piece] = uint32_t(_masks.size());
+            _masks.insert(_masks.end(), byCell[cell][piece].begin(), byCell[cell][piece].end());
+        }
+        _first[cell][nbPieces] = uint32_t(_masks.size());
+    }
+}
+
+template <bool stopAtFirst>
+bool PentaminoSolver::searchFromX(std::vector<uint64_t> const& xMasks)
+{
+    _count = 0;
+    for (uint64_t mask : xMasks)
+    {
+        _stack[0] = Placement{mask, _xPiece};
+        if (this->search<stopAtFirst>(emptyBoard | mask, 1u << _xPiece, 1))
+            return true;
+    }
+    return false;
+}
+
+template <bool stopAtFirst>
+bool PentaminoSolver::search(uint64_t board, unsigned used, unsigned depth)
+{
+    if (board == ~uint64_t(0))
+    {
+        ++_count;
+        return stopAtFirst;
+    }
+    if (hasIsolatedCell(board))
+        return false;
+
+    auto const& first = _first[lowest_bit_index(~board)];
+    for (unsigned free = ~used & ((1u << nbPieces) - 1); free; free &= free - 1)
+    {
+        unsigned const piece = lowest_bit_index(free);
+        for (uint32_t i = first[piece]; i < first[piece + 1]; ++i)
+        {
+            uint64_t const mask = _masks[i];
+            if (mask & board)
+                continue;
+            _stack[depth] = Placement{mask, uint8_t(piece)};
+            if (this->search<stopAtFirst>(board | mask, used | (1u << piece), depth + 1))
+                return true;
+        }
+    }
+    return false;
+}
+
+bool PentaminoSolver::findFirst(Solution& solution)
+{
+    if (!this->searchFromX<true>(_xAll))
+        return false;
+    solution = _stack;
+    return true;
+}
+
+size_t PentaminoSolver::countAll()
+{
+    this->searchFromX<false>(_xAll);
+    return _count;
+}
+
+size_t PentaminoSolver::countDistinct()
+{
+    this->searchFromX<false>(_xDistinct);
+    return _count;
+}
+
+size_t PentaminoSolver::placementCount() const
+{
+    return _xAll.size() + _masks.size();
+}
+
+char PentaminoSolver::pieceAt(Solution const& solution, unsigned x, unsigned y)
+{
+    for (auto const& placement : solution)
+    {
+        if (placement.mask & cellBit(x, y))
+            return Pentamino::all()[placement.piece].name();
+    }
+    return '.';
+}
+
+std::string PentaminoSolver::toText(Solution const& solution)
+{
+    std::string text;
+    for (unsigned y = 0; y < height; ++y)
+    {
+        for (unsigned x = 0; x < width; ++x)
+            text += pieceAt(solution, x, y);
+        text += '\n';
+    }
+    return text;
+}
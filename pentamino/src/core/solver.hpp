@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <string>
+#include <vector>
+
+#include "core/pentamino.hpp"
+
+// Exact cover of the 6x10 board (6 rows of 10 cells) by the 12 pentaminos.
+//
+// The board is a uint64_t, one bit per cell column by column (bit x * 6 + y),
+// so that the lowest empty cell is found with a single bit scan and the
+// search fills the board along its short side. Every placement of every
+// piece in every orientation is precomputed as a mask and filed under its
+// lowest cell and its piece: to fill the lowest empty cell, only the
+// placements of the unused pieces filed there can fit.
+//
+// The X, with the fewest placements, is put first. Any empty cell whose four
+// neighbours are full ends a branch at once.
+class PentaminoSolver
+{
+public:
+    static const unsigned width = 10;
+    static const unsigned height = 6;
+    static const unsigned nbCells = width * height;
+    static const unsigned nbPieces = 12;
+
+    struct Placement
+    {
+        uint64_t mask;
+        uint8_t piece;   // index in Pentamino::all()
+    };
+
+    // the placement of each piece, in the order they were put on the board
+    using Solution = std::array<Placement, nbPieces>;
+
+    PentaminoSolver();
+
+    // False when the board has no solution
+    bool findFirst(Solution& solution);
+
+    // Every solution, or one per class of solutions that are rotations or
+    // reflections of each other. The board has 4 symmetries and no solution
+    // is its own image, the first count is 4 times the second.
+    size_t countAll();
+    size_t countDistinct();
+
+    size_t placementCount() const;
+
+    // 6 rows of 10 piece letters
+    static std::string toText(Solution const& solution);
+
+    // Letter of the piece covering the cell
+    static char pieceAt(Solution const& solution, unsigned x, unsigned y);
+
+private:
+    template <bool stopAtFirst>
+    bool searchFromX(std::vector<uint64_t> const& xMasks);
+
+    template <bool stopAtFirst>
+    bool search(uint64_t board, unsigned used, unsigned depth);
+
+    // the cells past the board are always full
+    static const uint64_t emptyBoard = ~uint64_t(0) << nbCells;
+
+    uint8_t _xPiece;
+    std::vector<uint64_t> _xAll;
+    // the X, symmetric itself, only with its centre in the top left quarter
+    // of the board: exactly one solution of each symmetry class
+    std::vector<uint64_t> _xDistinct;
+
+    // placements of the other pieces, by lowest cell then piece: those of
+    // piece p at cell c are _masks[_first[c][p]] to _masks[_first[c][p + 1] - 1]
+    std::vector<uint64_t> _masks;
+    std::array<std::array<uint32_t, nbPieces + 1>, nbCells> _first;
+
+    Solution _stack;
+    size_t _count;
+};
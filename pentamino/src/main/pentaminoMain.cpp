@@ -1,29 +1,75 @@
 #include <iostream>
 #include <string>
+#include <chrono>
+#include "core/solver.hpp"
 #include "utils/drawable.hpp"
 #include "utils/ppm.hpp"
 
-int main(int argc, char** argv)
+namespace
 {
-    uint32_t width = 256;
-    uint32_t height = 256;
-    Drawable gd(width, height);
-    uint32_t color_tab[6]{ BLUE, BROWN, RED, ORANGE, GREEN, YELLOW};
-
-    gd.opaquerect(Rect(0, 0, width, height), gd.u32_to_color(BLACK));
-    size_t colorId = 0;
-    for (uint32_t y = 0; y < height; y += 32)
+    double elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // One coloured 32-pixel square per cell, a colour per piece
+    void drawSolution(PentaminoSolver::Solution const& solution, std::string const& path)
     {
-        for (uint32_t x = 0; x < width; x += 32)
+        uint32_t const cellSize = 32;
+        uint32_t width = PentaminoSolver::width * cellSize;
+        uint32_t height = PentaminoSolver::height * cellSize;
+        Drawable gd(width, height);
+        uint32_t color_tab[PentaminoSolver::nbPieces]{ BLUE, BROWN, RED, ORANGE, GREEN, YELLOW,
+                                                       CYAN, PINK, DARK_BLUE, DARK_GREEN, GREY, LIGHT_ORANGE};
+        std::string const names = "FILNPTUVWXYZ";
+
+        gd.opaquerect(Rect(0, 0, width, height), gd.u32_to_color(BLACK));
+        for (uint32_t y = 0; y < PentaminoSolver::height; ++y)
         {
-            gd.opaquerect(Rect(x, y, 32, 32), gd.u32_to_color(color_tab[colorId]));
-            ++colorId;
-            if (colorId >= 6)
-                colorId = 0;
+            for (uint32_t x = 0; x < PentaminoSolver::width; ++x)
+            {
+                size_t colorId = names.find(PentaminoSolver::pieceAt(solution, x, y));
+                gd.opaquerect(Rect(x * cellSize, y * cellSize, cellSize, cellSize), gd.u32_to_color(color_tab[colorId]));
+            }
         }
+
+        // save in ppm file
+        PPMImage::writeBinaryImage(path, reinterpret_cast<char const*>(gd.data()), gd.width(), gd.height(), gd.bpp() / 8);
+    }
+}
+
+// Usage: pentamino [--first]
+//   --first: stop at the first solution, otherwise also count every
+//            solution and the distinct ones
+int main(int argc, char** argv)
+{
+    bool firstOnly = argc > 1 && std::string(argv[1]) == "--first";
+
+    auto start = std::chrono::steady_clock::now();
+    PentaminoSolver solver;
+    std::cout << solver.placementCount() << " placements in " << elapsedMs(start) << " ms" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    PentaminoSolver::Solution solution;
+    if (!solver.findFirst(solution))
+    {
+        std::cerr << "no solution" << std::endl;
+        return 1;
     }
+    std::cout << "first solution in " << elapsedMs(start) << " ms" << std::endl;
+    std::cout << PentaminoSolver::toText(solution);
+    drawSolution(solution, "pentamino.ppm");
+
+    if (firstOnly)
+        return 0;
+
+    start = std::chrono::steady_clock::now();
+    size_t distinct = solver.countDistinct();
+    std::cout << distinct << " distinct solutions in " << elapsedMs(start) << " ms" << std::endl;
 
-    // save in ppm file
-    PPMImage::writeBinaryImage("pentamino.ppm", reinterpret_cast<char const*>(gd.data()), gd.width(), gd.height(), gd.bpp() / 8);
+    start = std::chrono::steady_clock::now();
+    size_t all = solver.countAll();
+    std::cout << all << " solutions with their rotations and reflections in " << elapsedMs(start) << " ms"
+              << std::endl;
     return 0;
 }
@@ -3,6 +3,10 @@
 #include <cstdint>
 #include <cstddef>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 constexpr static inline uint16_t align4(uint16_t value) noexcept
 {
     return (value+3) & ~3;
@@ -73,3 +77,14 @@ static inline void reverseit(uint8_t *buffer, size_t n) noexcept
     }
 }
 
+// Index of the lowest set bit, value must not be 0
+static inline unsigned lowest_bit_index(uint64_t value) noexcept
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(value));
+#endif
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// computeHash of several arrays at once. One hash is a serial chain, each
+// step waits for the previous one (shift, add, add, xor: ~4 cycles/value),
+// so a single hash leaves most of the core idle. Advancing up to 8 chains in
+// lockstep fills it: 4 chains per AVX2 register with 64-bit lanes, or
+// interleaved scalar chains in groups of 4 (more spill out of registers).
+// Every hash is exactly computeHash.
+//
+// All the lanes advance until the shortest one ends, then the lane that
+// ended takes the next array, so the lanes stay full until the last arrays.
+class BatchHash
+{
+public:
+    static const size_t maxLanes = 8;
+
+    // hashes[i] = computeHash(*arrays[i]), for any count
+    static void hash(std::vector<uint32_t> const* const* arrays, size_t count, uint64_t* hashes)
+    {
+        Lane lanes[maxLanes];
+        size_t active = 0;
+        size_t nextArray = 0;
+        while (active < maxLanes && take(arrays, count, hashes, nextArray, lanes[active]))
+            ++active;
+
+        while (active > 0)
+        {
+            size_t steps = lanes[0].remaining();
+            for (size_t l = 1; l < active; ++l)
+                steps = std::min(steps, lanes[l].remaining());
+            advance(lanes, active, steps);
+
+            for (size_t l = 0; l < active;)
+            {
+                if (lanes[l].remaining() > 0)
+                {
+                    ++l;
+                    continue;
+                }
+                hashes[lanes[l].index] = lanes[l].hash;
+                if (!take(arrays, count, hashes, nextArray, lanes[l]))
+                    lanes[l] = lanes[--active];
+            }
+        }
+    }
+
+private:
+    static const uint64_t constant = 0x9e3779b9f83da20c;
+
+    struct Lane
+    {
+        uint32_t const* next;
+        uint32_t const* last;
+        uint64_t hash;
+        size_t index;
+
+        size_t remaining() const { return static_cast<size_t>(last - next); }
+    };
+
+    // Loads the next non-empty array in lane, false when there is none left.
+    // An empty array hashes to its size, 0, without taking a lane.
+    static bool take(std::vector<uint32_t> const* const* arrays, size_t count, uint64_t* hashes,
+                     size_t& nextArray, Lane& lane)
+    {
+        for (; nextArray < count; ++nextArray)
+        {
+            std::vector<uint32_t> const& numbers = *arrays[nextArray];
+            if (numbers.empty())
+            {
+                hashes[nextArray] = 0;
+                continue;
+            }
+            lane.next = numbers.data();
+            lane.last = numbers.data() + numbers.size();
+            lane.hash = numbers.size();
+            lane.index = nextArray++;
+            return true;
+        }
+        return false;
+    }
+
+    static void advance(Lane* lanes, size_t active, size_t steps)
+    {
+        switch (active)
+        {
+        case 8: advanceLanes<8>(lanes, steps); break;
+        case 7: advanceLanes<7>(lanes, steps); break;
+        case 6: advanceLanes<6>(lanes, steps); break;
+        case 5: advanceLanes<5>(lanes, steps); break;
+        case 4: advanceLanes<4>(lanes, steps); break;
+        case 3: advanceLanes<3>(lanes, steps); break;
+        case 2: advanceLanes<2>(lanes, steps); break;
+        default: advanceLanes<1>(lanes, steps); break;
+        }
+    }
+
+    // Interleaved scalar chains, every hash kept in a register
+    template <size_t Lanes>
+    static void advanceScalar(Lane* lanes, size_t first, size_t steps)
+    {
+        uint64_t hash[Lanes];
+        uint32_t const* next[Lanes];
+        for (size_t l = 0; l < Lanes; ++l)
+        {
+            hash[l] = lanes[l].hash;
+            next[l] = lanes[l].next;
+        }
+        for (size_t i = first; i < steps; ++i)
+        {
+#pragma GCC unroll 4
+            for (size_t l = 0; l < Lanes; ++l)
+                hash[l] ^= next[l][i] + constant + (hash[l] << 6) + (hash[l] >> 2);
+        }
+        for (size_t l = 0; l < Lanes; ++l)
+            lanes[l].hash = hash[l];
+    }
+
+    // Groups of at most 4 scalar chains, one after the other
+    template <size_t Lanes>
+    static void advanceScalarGroups(Lane* lanes, size_t first, size_t steps)
+    {
+        if (Lanes > 4)
+        {
+            advanceScalar<4>(lanes, first, steps);
+            advanceScalarGroups<(Lanes > 4 ? Lanes - 4 : 1)>(lanes + 4, first, steps);
+        }
+        else
+            advanceScalar<Lanes>(lanes, first, steps);
+    }
+
+#if defined(__AVX2__)
+    // The same step on the 4 chains of a register. Values come 4 at a time
+    // from each chain, a 4x4 transpose turns them into 4 steps of the quad.
+    struct Quad
+    {
+        __m256i hash;
+        uint32_t const* next[4];
+
+        void load(Lane const* lanes)
+        {
+            hash = _mm256_set_epi64x(int64_t(lanes[3].hash), int64_t(lanes[2].hash),
+                                     int64_t(lanes[1].hash), int64_t(lanes[0].hash));
+            for (size_t l = 0; l < 4; ++l)
+                next[l] = lanes[l].next;
+        }
+
+        void store(Lane* lanes) const
+        {
+            alignas(32) uint64_t hashes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(hashes), hash);
+            for (size_t l = 0; l < 4; ++l)
+                lanes[l].hash = hashes[l];
+        }
+
+        void step(__m128i values)
+        {
+            __m256i const value = _mm256_add_epi64(_mm256_cvtepu32_epi64(values),
+                                                   _mm256_set1_epi64x(int64_t(constant)));
+            __m256i const mixed = _mm256_add_epi64(_mm256_slli_epi64(hash, 6), _mm256_srli_epi64(hash, 2));
+            hash = _mm256_xor_si256(hash, _mm256_add_epi64(value, mixed));
+        }
+
+        void advance4(size_t i)
+        {
+            __m128i const a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(next[0] + i));
+            __m128i const b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(next[1] + i));
+            __m128i const c = _mm_loadu_si128(reinterpret_cast<__m128i const*>(next[2] + i));
+            __m128i const d = _mm_loadu_si128(reinterpret_cast<__m128i const*>(next[3] + i));
+            __m128i const ab0 = _mm_unpacklo_epi32(a, b);
+            __m128i const ab1 = _mm_unpackhi_epi32(a, b);
+            __m128i const cd0 = _mm_unpacklo_epi32(c, d);
+            __m128i const cd1 = _mm_unpackhi_epi32(c, d);
+            step(_mm_unpacklo_epi64(ab0, cd0));
+            step(_mm_unpackhi_epi64(ab0, cd0));
+            step(_mm_unpacklo_epi64(ab1, cd1));
+            step(_mm_unpackhi_epi64(ab1, cd1));
+        }
+    };
+
+    // Whole quads of chains on AVX2 registers, the other chains in scalar
+    template <size_t Lanes>
+    static void advanceLanes(Lane* lanes, size_t steps)
+    {
+        static const size_t nbQuads = Lanes / 4;
+        static const size_t rest = Lanes % 4;
+
+        if (nbQuads)
+        {
+            size_t const vectorSteps = steps / 4 * 4;
+            Quad quads[nbQuads ? nbQuads : 1];
+            for (size_t q = 0; q < nbQuads; ++q)
+                quads[q].load(lanes + 4 * q);
+            for (size_t i = 0; i < vectorSteps; i += 4)
+            {
+                for (size_t q = 0; q < nbQuads; ++q)
+                    quads[q].advance4(i);
+            }
+            for (size_t q = 0; q < nbQuads; ++q)
+                quads[q].store(lanes + 4 * q);
+            advanceScalarGroups<(nbQuads ? 4 * nbQuads : 1)>(lanes, vectorSteps, steps);
+        }
+        if (rest)
+            advanceScalar<(rest ? rest : 1)>(lanes + 4 * nbQuads, 0, steps);
+        for (size_t l = 0; l < Lanes; ++l)
+            lanes[l].next += steps;
+    }
+#else
+    template <size_t Lanes>
+    static void advanceLanes(Lane* lanes, size_t steps)
+    {
+        advanceScalarGroups<Lanes>(lanes, 0, steps);
+        for (size_t l = 0; l < Lanes; ++l)
+            lanes[l].next += steps;
+    }
+#endif
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <mutex>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+// Recycles the number buffers between seeds: a released buffer keeps its
+// capacity, so once every worker has seen a large seed there are no more
+// allocations, and no more first-touch page faults on fresh memory.
+//
+// With hugePages, every newly reserved buffer is advised for transparent
+// huge pages (Linux, THP in "madvise" or "always" mode), one fault maps 2 MB.
+class BufferPool
+{
+public:
+    using Buffer = std::vector<uint32_t>;
+
+    explicit BufferPool(bool hugePages = false)
+        : _hugePages(hugePages)
+    {}
+
+    Buffer acquire()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_free.empty())
+        {
+            ++_created;
+            return Buffer();
+        }
+        Buffer buffer = std::move(_free.back());
+        _free.pop_back();
+        return buffer;
+    }
+
+    void release(Buffer&& buffer)
+    {
+        buffer.clear();
+        std::lock_guard<std::mutex> lock(_mutex);
+        _free.push_back(std::move(buffer));
+    }
+
+    // Like buffer.reserve(size), advising huge pages when it reallocates
+    void reserve(Buffer& buffer, size_t size) const
+    {
+        if (size <= buffer.capacity())
+            return;
+        buffer.reserve(size);
+        if (_hugePages)
+            adviseHugePages(buffer.data(), buffer.capacity() * sizeof(uint32_t));
+    }
+
+    // Number of distinct buffers handed out since the creation of the pool
+    size_t created() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _created;
+    }
+
+private:
+    static void adviseHugePages(void* data, size_t size)
+    {
+#ifdef __linux__
+        static const uintptr_t hugePageSize = 2 * 1024 * 1024;
+        uintptr_t begin = (reinterpret_cast<uintptr_t>(data) + hugePageSize - 1) & ~(hugePageSize - 1);
+        uintptr_t end = (reinterpret_cast<uintptr_t>(data) + size) & ~(hugePageSize - 1);
+        if (begin < end)
+            ::madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE);
+#else
+        (void)data;
+        (void)size;
+#endif
+    }
+
+    bool _hugePages;
+    mutable std::mutex _mutex;
+    std::vector<Buffer> _free;
+    size_t _created = 0;
+};
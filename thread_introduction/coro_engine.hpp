@@ -0,0 +1,173 @@
+#pragma once
+
+// Pieces to run seeds as C++20 coroutines on a ThreadPool. Everything is
+// behind COROUTINES_AVAILABLE, 0 when the compiler is in C++17 mode (or has
+// no <coroutine>), so the program still builds without them.
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define COROUTINES_AVAILABLE 1
+#endif
+#endif
+#ifndef COROUTINES_AVAILABLE
+#define COROUTINES_AVAILABLE 0
+#endif
+
+#if COROUTINES_AVAILABLE
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <map>
+#include <mutex>
+
+#include "thread_pool.hpp"
+
+// Coroutine nobody waits for: it starts right away and frees itself when
+// it returns, completion is signalled by the coroutine itself
+struct DetachedTask
+{
+    struct promise_type
+    {
+        DetachedTask get_return_object() noexcept { return DetachedTask(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+// co_await scheduler.schedule() suspends the coroutine and resumes it on a
+// worker of the pool, behind the coroutines already queued there
+class CoroScheduler
+{
+public:
+    explicit CoroScheduler(ThreadPool& pool)
+        : _pool(pool)
+    {}
+
+    struct ScheduleAwaiter
+    {
+        CoroScheduler& scheduler;
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> coroutine)
+        {
+            ++scheduler._hops;
+            scheduler._pool.submit([coroutine] { coroutine.resume(); });
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    ScheduleAwaiter schedule() { return ScheduleAwaiter{*this}; }
+
+    // Resumptions queued so far
+    size_t hops() const { return _hops.load(); }
+
+private:
+    ThreadPool& _pool;
+    std::atomic<size_t> _hops{0};
+};
+
+// Hashes completed in any order, awaited in seed order by a single consumer
+// coroutine. The consumer waiting for a seed is resumed by whichever thread
+// completes that seed, and keeps going while the following ones are there.
+class OrderedResults
+{
+public:
+    explicit OrderedResults(size_t firstSeed)
+        : _next(firstSeed)
+    {}
+
+    OrderedResults(OrderedResults const&) = delete;
+    OrderedResults& operator=(OrderedResults const&) = delete;
+
+    struct NextAwaiter
+    {
+        OrderedResults& results;
+        uint64_t hash = 0;
+
+        bool await_ready()
+        {
+            std::lock_guard<std::mutex> lock(results._mutex);
+            return results.take(hash);
+        }
+
+        bool await_suspend(std::coroutine_handle<> consumer)
+        {
+            std::lock_guard<std::mutex> lock(results._mutex);
+            // completed between await_ready and now
+            if (results.take(hash))
+                return false;
+            results._consumer = consumer;
+            results._awaiter = this;
+            return true;
+        }
+
+        uint64_t await_resume() const noexcept { return hash; }
+    };
+
+    // Hash of the next seed in order
+    NextAwaiter next() { return NextAwaiter{*this}; }
+
+    // Nothing of this object is touched once the consumer is resumed: the
+    // last seed may let its owner destroy it
+    void complete(size_t seed, uint64_t hash)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (!_consumer || seed != _next)
+        {
+            _ready.emplace(seed, hash);
+            return;
+        }
+        _awaiter->hash = hash;
+        advance();
+        std::coroutine_handle<> consumer = _consumer;
+        _consumer = nullptr;
+        lock.unlock();
+        consumer.resume();
+    }
+
+    // Blocks until seed is less than window seeds ahead of the consumer
+    void waitForRoom(size_t seed, size_t window)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _advanced.wait(lock, [this, seed, window] { return seed - _next < window; });
+    }
+
+    // Blocks until the consumer took every seed before end
+    void waitUntil(size_t end)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _advanced.wait(lock, [this, end] { return _next >= end; });
+    }
+
+private:
+    bool take(uint64_t& hash)
+    {
+        auto ready = _ready.find(_next);
+        if (ready == _ready.end())
+            return false;
+        hash = ready->second;
+        _ready.erase(ready);
+        advance();
+        return true;
+    }
+
+    void advance()
+    {
+        ++_next;
+        _advanced.notify_all();
+    }
+
+    size_t _next;
+    std::map<size_t, uint64_t> _ready;
+    std::coroutine_handle<> _consumer;
+    NextAwaiter* _awaiter = nullptr;
+    std::mutex _mutex;
+    std::condition_variable _advanced;
+};
+#endif
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+// Incremental form of computeHash: feeding the sorted numbers in order, in
+// any number of slices, gives the same value.
+class StreamHash
+{
+public:
+    explicit StreamHash(size_t count)
+        : _hash(count)
+    {}
+
+    void update(uint32_t const* first, uint32_t const* last)
+    {
+        uint64_t hash = _hash;
+        for (; first != last; ++first)
+            hash ^= *first + 0x9e3779b9f83da20c + (hash << 6) + (hash >> 2);
+        _hash = hash;
+    }
+
+    uint64_t value() const { return _hash; }
+
+private:
+    uint64_t _hash;
+};
+
+// Scratch storage that is never value-initialised: new uint32_t[n] leaves
+// the values indeterminate, so nothing is written before the caller fills
+// it. Grows only, kept between calls until reset.
+class UninitializedBuffer
+{
+public:
+    uint32_t* get(size_t count)
+    {
+        if (count > _capacity)
+        {
+            _data.reset();
+            _data.reset(new uint32_t[count]);
+            _capacity = count;
+        }
+        return _data.get();
+    }
+
+    void reset()
+    {
+        _data.reset();
+        _capacity = 0;
+    }
+
+private:
+    std::unique_ptr<uint32_t[]> _data;
+    size_t _capacity = 0;
+};
+
+struct NoBucketCallback
+{
+    void operator()(uint32_t const*, uint32_t const*) const {}
+};
+
+struct StdBucketSort
+{
+    void operator()(uint32_t* first, uint32_t* last) const { std::sort(first, last); }
+};
+
+// Values per bucket block for count values in 2^bucketBits buckets: the
+// mean and 6 standard deviations, so a bucket almost never overflows it.
+inline size_t bucketCapacity(size_t count, unsigned bucketBits)
+{
+    double const mean = static_cast<double>(count) / static_cast<double>(size_t(1) << bucketBits);
+    return static_cast<size_t>(mean + 6 * std::sqrt(mean)) + 16;
+}
+
+// Scratch values generateBucketSorted uses for count values
+inline size_t bucketScratchSize(size_t count, unsigned bucketBits)
+{
+    return bucketCapacity(count, bucketBits) << bucketBits;
+}
+
+// Generates count values from generator straight into the bucket of their
+// top bucketBits bits, then sorts each bucket on its own: the array is never
+// sorted cold as a whole, every bucket sort works on a few KB that stay in
+// L1/L2.
+//
+// Each value is generated once and written to the block of its bucket, one
+// fixed block of bucketCapacity values per bucket in scratch. The values of
+// a full block go to a spill array instead, sorted afterwards and joined to
+// their bucket before its sort.
+//
+// sortBucket(first, last) sorts a bucket in place. bucketSorted(first,
+// last) is called on every bucket, in order, right after it is sorted, while
+// it is still in cache: the buckets in a row are the sorted values.
+template <typename Generator, typename BucketSort = StdBucketSort, typename BucketCallback = NoBucketCallback>
+void generateBucketSorted(Generator& generator, size_t count, unsigned bucketBits, UninitializedBuffer& scratch,
+                          BucketSort sortBucket = BucketSort(), BucketCallback bucketSorted = BucketCallback())
+{
+    size_t const nbBuckets = size_t(1) << bucketBits;
+    unsigned const shift = 32 - bucketBits;
+    size_t const capacity = bucketCapacity(count, bucketBits);
+
+    thread_local std::vector<uint32_t> sizes;
+    thread_local std::vector<uint32_t> spill;
+    thread_local std::vector<uint32_t> joined;
+    sizes.assign(nbBuckets, 0);
+    spill.clear();
+
+    uint32_t* blocks = scratch.get(capacity * nbBuckets);
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint32_t value = generator();
+        size_t bucket = value >> shift;
+        uint32_t size = sizes[bucket];
+        if (size < capacity)
+        {
+            blocks[bucket * capacity + size] = value;
+            sizes[bucket] = size + 1;
+        }
+        else
+            spill.push_back(value);
+    }
+
+    // sorted, the spilled values are grouped by bucket
+    std::sort(spill.begin(), spill.end());
+    auto spilled = spill.begin();
+    for (size_t b = 0; b < nbBuckets; ++b)
+    {
+        uint32_t* first = blocks + b * capacity;
+        uint32_t* last = first + sizes[b];
+        auto spillEnd = spilled;
+        while (spillEnd != spill.end() && (*spillEnd >> shift) == b)
+            ++spillEnd;
+        if (spillEnd != spilled)
+        {
+            joined.assign(first, last);
+            joined.insert(joined.end(), spilled, spillEnd);
+            first = joined.data();
+            last = first + joined.size();
+            spilled = spillEnd;
+        }
+        sortBucket(first, last);
+        bucketSorted(first, last);
+    }
+}
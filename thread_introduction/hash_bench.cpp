@@ -0,0 +1,86 @@
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <string>
+
+#include "batch_hash.hpp"
+
+// Same as computeHash in main.cpp
+static uint64_t referenceHash(std::vector<uint32_t> const& numbers)
+{
+    uint64_t hash = numbers.size();
+    for (auto& i : numbers)
+    {
+        hash ^= i + 0x9e3779b9f83da20c + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
+
+// Hash throughput: computeHash one array at a time against BatchHash on
+// batches of 2 to 8 arrays and on all of them at once, over seeds sized
+// like the main program's, checking every hash matches.
+//
+// Usage: hash_bench [seeds] [repetitions]
+int main(int argc, char** argv)
+{
+    using Clock = std::chrono::steady_clock;
+
+    size_t nbSeeds = argc > 1 ? std::stoul(argv[1]) : 64;
+    size_t nbRepetitions = argc > 2 ? std::stoul(argv[2]) : 10;
+    std::vector<std::vector<uint32_t>> arrays(nbSeeds);
+    std::vector<uint64_t> expected(nbSeeds);
+    double total = 0.;
+
+    for (size_t seed = 0; seed < nbSeeds; ++seed)
+    {
+        std::mt19937 generator(static_cast<uint32_t>(seed));
+        arrays[seed].resize((generator() % 1000000) + 100000);
+        for (auto& value : arrays[seed])
+            value = generator();
+        total += static_cast<double>(arrays[seed].size());
+    }
+    total *= static_cast<double>(nbRepetitions);
+
+    auto start = Clock::now();
+    for (size_t r = 0; r < nbRepetitions; ++r)
+    {
+        for (size_t seed = 0; seed < nbSeeds; ++seed)
+            expected[seed] = referenceHash(arrays[seed]);
+    }
+    double serialSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::setw(12) << "computeHash" << std::setw(10) << total / serialSeconds * 1e-6 << " Mvalues/s" << std::endl;
+
+    std::vector<std::vector<uint32_t> const*> batch(nbSeeds);
+    std::vector<uint64_t> hashes(nbSeeds);
+    for (size_t width : {size_t(2), size_t(4), size_t(8), nbSeeds})
+    {
+        start = Clock::now();
+        for (size_t r = 0; r < nbRepetitions; ++r)
+        {
+            for (size_t first = 0; first < nbSeeds; first += width)
+            {
+                size_t count = std::min(width, nbSeeds - first);
+                for (size_t l = 0; l < count; ++l)
+                    batch[l] = &arrays[first + l];
+                BatchHash::hash(batch.data(), count, hashes.data());
+                for (size_t l = 0; l < count; ++l)
+                {
+                    if (hashes[l] != expected[first + l])
+                    {
+                        std::cerr << "BatchHash differs from computeHash for seed " << first + l << std::endl;
+                        return 2;
+                    }
+                }
+            }
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << std::setw(10) << "batch of " << std::setw(2) << width << std::setw(10) << total / seconds * 1e-6 << " Mvalues/s"
+                  << "  (x" << std::setprecision(2) << serialSeconds / seconds << ")" << std::setprecision(1) << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <string>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// splitmix64 finaliser: every bit of x moves about half the bits of the result
+inline uint64_t mixBits(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+    return x ^ (x >> 31);
+}
+
+// Persistent seed -> hash table in a memory-mapped file, shared by every
+// thread and process mapping it, so reruns over the same seeds skip them.
+//
+// Open addressing with linear probing over fixed 32-byte slots. A slot is
+// claimed by a CAS of its state from empty to writing, filled, then
+// published as ready; readers only trust ready slots. A process killed in
+// the middle leaves a writing slot that everyone probes past, nothing
+// waits on it. Entries are never removed: a result that finds no free slot
+// within maxProbes of its home slot is simply not stored.
+//
+// The header carries a format and an algorithm version: a file written by
+// another version is replaced by an empty one when opened, renamed over it,
+// so that processes still mapping the old file never write into the new
+// one. Bump algorithmVersion whenever generating, sorting or hashing a seed,
+// or the workload key of its caller, changes.
+class HashCache
+{
+public:
+    static const uint32_t algorithmVersion = 2;
+    static const size_t maxProbes = 256;
+
+    HashCache() = default;
+
+    ~HashCache()
+    {
+        close();
+    }
+
+    HashCache(HashCache const&) = delete;
+    HashCache& operator=(HashCache const&) = delete;
+
+    // capacity (rounded up to a power of two) only applies to a new file,
+    // an existing valid one keeps its own
+    bool open(std::string const& path, size_t capacity)
+    {
+#ifdef __unix__
+        close();
+        // one process at a time creates or replaces the file: the lock is on
+        // the file under path, taken again if it was replaced meanwhile
+        int fd = -1;
+        struct stat st;
+        for (;;)
+        {
+            fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+            if (fd < 0)
+                return false;
+            ::flock(fd, LOCK_EX);
+            struct stat current;
+            if (::fstat(fd, &st) != 0)
+            {
+                ::close(fd);
+                return false;
+            }
+            if (::stat(path.c_str(), &current) == 0 && current.st_dev == st.st_dev && current.st_ino == st.st_ino)
+                break;
+            ::close(fd);
+        }
+
+        size_t slots = 1024;
+        while (slots < capacity)
+            slots *= 2;
+
+        Header header;
+        bool valid = static_cast<size_t>(st.st_size) >= sizeof(Header)
+                     && ::pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header))
+                     && header.magic == magic && header.formatVersion == formatVersion
+                     && header.algorithmVersion == algorithmVersion
+                     && header.capacity && (header.capacity & (header.capacity - 1)) == 0
+                     && static_cast<size_t>(st.st_size) == mappedSize(header.capacity);
+        _reset = !valid;
+        if (valid)
+            slots = header.capacity;
+        else
+        {
+            // Never truncate a file that other processes may have mapped:
+            // the new one is built aside then renamed over it, a process
+            // still on the old version keeps writing to the orphaned file
+            header.magic = magic;
+            header.formatVersion = formatVersion;
+            header.algorithmVersion = algorithmVersion;
+            header.capacity = slots;
+            std::string const newPath = path + ".new." + std::to_string(::getpid());
+            int newFd = ::open(newPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            // a sparse file, only the slots in use take disk space
+            valid = newFd >= 0 && ::ftruncate(newFd, static_cast<off_t>(mappedSize(slots))) == 0
+                    && ::pwrite(newFd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header))
+                    && ::rename(newPath.c_str(), path.c_str()) == 0;
+            if (!valid && newFd >= 0)
+                ::unlink(newPath.c_str());
+            // closing the old file releases the processes waiting on its
+            // lock, they find the new file under path
+            ::close(fd);
+            fd = newFd;
+        }
+
+        void* data = valid ? ::mmap(nullptr, mappedSize(slots), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        if (fd >= 0)
+        {
+            ::flock(fd, LOCK_UN);
+            ::close(fd);
+        }
+        if (data == MAP_FAILED)
+            return false;
+
+        _data = data;
+        _slots = reinterpret_cast<Slot*>(static_cast<char*>(data) + sizeof(Header));
+        _mask = slots - 1;
+        return true;
+#else
+        (void)path;
+        (void)capacity;
+        return false;
+#endif
+    }
+
+    void close()
+    {
+#ifdef __unix__
+        if (_data)
+            ::munmap(_data, mappedSize(_mask + 1));
+#endif
+        _data = nullptr;
+        _slots = nullptr;
+    }
+
+    bool isOpen() const { return _slots != nullptr; }
+
+    // True when the file was created or reset by open
+    bool wasReset() const { return _reset; }
+
+    size_t capacity() const { return _slots ? _mask + 1 : 0; }
+
+    bool find(uint64_t seed, uint64_t workload, uint64_t& hash)
+    {
+        size_t index = slotOf(seed, workload);
+        for (size_t probe = 0; probe < maxProbes; ++probe, index = (index + 1) & _mask)
+        {
+            Slot& slot = _slots[index];
+            uint32_t state = slot.state.load(std::memory_order_acquire);
+            if (state == empty)
+                break;
+            if (state == ready && slot.seed == seed && slot.workload == workload)
+            {
+                hash = slot.hash;
+                ++_hits;
+                return true;
+            }
+        }
+        ++_misses;
+        return false;
+    }
+
+    // Returns false when no slot was free near its home slot
+    bool insert(uint64_t seed, uint64_t workload, uint64_t hash)
+    {
+        size_t index = slotOf(seed, workload);
+        for (size_t probe = 0; probe < maxProbes; ++probe, index = (index + 1) & _mask)
+        {
+            Slot& slot = _slots[index];
+            uint32_t state = slot.state.load(std::memory_order_acquire);
+            if (state == ready && slot.seed == seed && slot.workload == workload)
+                return true;
+            if (state == empty && slot.state.compare_exchange_strong(state, writing, std::memory_order_acquire))
+            {
+                slot.seed = seed;
+                slot.workload = workload;
+                slot.hash = hash;
+                slot.state.store(ready, std::memory_order_release);
+                ++_stored;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Counters of this process
+    size_t hits() const { return _hits.load(); }
+    size_t misses() const { return _misses.load(); }
+    size_t stored() const { return _stored.load(); }
+
+private:
+    static const uint64_t magic = 0x48534843'53454544; // "HSHCSEED"
+    static const uint32_t formatVersion = 1;
+    static const uint32_t empty = 0;
+    static const uint32_t writing = 1;
+    static const uint32_t ready = 2;
+
+    struct Header
+    {
+        uint64_t magic = 0;
+        uint32_t formatVersion = 0;
+        uint32_t algorithmVersion = 0;
+        uint64_t capacity = 0;
+        uint64_t reserved[5] = {};
+    };
+
+    struct Slot
+    {
+        std::atomic<uint32_t> state;
+        uint32_t reserved;
+        uint64_t seed;
+        uint64_t workload;
+        uint64_t hash;
+    };
+
+    static_assert(sizeof(Header) == 64, "the slots start on a cache line");
+    static_assert(sizeof(Slot) == 32, "two slots per cache line");
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "the slot state is shared between processes");
+
+    static size_t mappedSize(size_t slots) { return sizeof(Header) + slots * sizeof(Slot); }
+
+    size_t slotOf(uint64_t seed, uint64_t workload) const
+    {
+        return static_cast<size_t>(mixBits(seed ^ (workload * 0x9e3779b97f4a7c15))) & _mask;
+    }
+
+    void* _data = nullptr;
+    Slot* _slots = nullptr;
+    size_t _mask = 0;
+    bool _reset = false;
+    std::atomic<size_t> _hits{0};
+    std::atomic<size_t> _misses{0};
+    std::atomic<size_t> _stored{0};
+};
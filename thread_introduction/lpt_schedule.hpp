@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <queue>
+#include <numeric>
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+// Longest Processing Time first scheduling helpers.
+// costs[i] is the predicted cost of task i, any unit.
+
+// Task indices ordered by decreasing cost (ties keep index order).
+inline std::vector<size_t> longestFirst(std::vector<double> const& costs)
+{
+    std::vector<size_t> order(costs.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&costs](size_t a, size_t b)
+    {
+        return costs[a] > costs[b];
+    });
+    return order;
+}
+
+struct LptBins
+{
+    std::vector<std::vector<size_t>> tasks;
+    std::vector<double> loads;
+};
+
+// Greedy LPT packing: every task, largest first, goes to the least loaded
+// bin. The makespan is within 4/3 of the optimal one.
+inline LptBins packBins(std::vector<double> const& costs, size_t nbBins)
+{
+    if (nbBins == 0)
+        nbBins = 1;
+
+    LptBins bins;
+    bins.tasks.resize(nbBins);
+    bins.loads.assign(nbBins, 0.);
+
+    using Entry = std::pair<double, size_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> leastLoaded;
+    for (size_t b = 0; b < nbBins; ++b)
+        leastLoaded.emplace(0., b);
+
+    for (size_t task : longestFirst(costs))
+    {
+        Entry entry = leastLoaded.top();
+        leastLoaded.pop();
+        bins.tasks[entry.second].push_back(task);
+        bins.loads[entry.second] += costs[task];
+        leastLoaded.emplace(bins.loads[entry.second], entry.second);
+    }
+    return bins;
+}
@@ -1,65 +1,1133 @@
 #include <cstdint>
 #include <iostream>
+#include <iomanip>
 #include <vector>
 #include <algorithm>
 #include <random>
 #include <fstream>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <array>
+#include <new>
+#include <cstdlib>
+#include <memory>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
 
-std::vector<uint32_t> generateNumbers(size_t seed)
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "seed_hashing.hpp"
+#include "ordered_writer.hpp"
+#include "lpt_schedule.hpp"
+#include "bounded_queue.hpp"
+#include "batch_hash.hpp"
+#include "coro_engine.hpp"
+
+// Every allocation of the program goes through here, to count them.
+// Not inlined, so GCC does not pair the malloc/free inside with new/delete
+// at every call site (-Wmismatched-new-delete).
+static std::atomic<size_t> g_allocations(0);
+static std::atomic<size_t> g_allocatedBytes(0);
+
+__attribute__((noinline)) void* operator new(size_t size)
+{
+    ++g_allocations;
+    g_allocatedBytes += size;
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+// The seed job's options, and which seeds main runs and how
+struct Options : SeedOptions
+{
+    // seeds firstSeed to firstSeed + nbSeeds - 1
+    size_t firstSeed = 0;
+    size_t nbSeeds = 1000;
+    size_t nbThreads = std::thread::hardware_concurrency();
+    std::array<size_t, 3> stageThreads = {{2, 4, 1}};
+    size_t queueCapacity = 8;
+    // sorted arrays the pipeline hash stage takes at once and hashes in lockstep
+    size_t hashBatch = 1;
+    // streamed output: the schedulers taking seeds in order do not take one
+    // beyond its reorder window, so its memory stays bounded
+    OrderedWriter* output = nullptr;
+};
+
+void writeHashList(std::vector<uint64_t> const& hash_list)
+{
+    std::fstream output_file("output.txt", std::ios_base::out | std::ios_base::trunc);
+    for (auto hash : hash_list)
+    {
+        output_file << hash << "\n";
+    }
+}
+
+// Sorting dominates, so a seed of n numbers costs about n log n. Indexed
+// from the first seed of the range.
+std::vector<double> predictCosts(Options const& options)
+{
+    std::vector<double> costs(options.nbSeeds);
+    for (size_t i = 0; i < options.nbSeeds; ++i)
+    {
+        double n = static_cast<double>(predictSize(options.firstSeed + i, options));
+        costs[i] = n * std::log2(n);
+    }
+    return costs;
+}
+
+// Thread safe '\r' percentage on std::cout, printed every 100 seeds or every
+// percent on large runs
+class Progress
+{
+public:
+    explicit Progress(size_t total)
+        : _total(total)
+        , _step(std::max<size_t>(100, total / 100))
+    {}
+
+    void tick()
+    {
+        size_t count = ++_done;
+        if ((count % _step) == 0)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::cout << '\r' << (count * 100 / _total) << "%" << std::flush;
+        }
+    }
+
+private:
+    size_t _total;
+    size_t _step;
+    std::atomic<size_t> _done{0};
+    std::mutex _mutex;
+};
+
+// Pins each worker of a scheduler and binds it to its arena, with --pin
+static std::function<void(size_t)> placeWorkers(Options const& options)
+{
+    WorkerPlacement* placement = options.placement;
+    if (!placement)
+        return std::function<void(size_t)>();
+    return [placement](size_t worker) { placement->start(worker); };
+}
+
+// processSeed, once the seed fits in the reorder window of a streamed
+// output. Only the worker about to run the seed waits.
+static SeedExecutor::HashSeed hashInWindow(Options const& options)
+{
+    return [&options](size_t seed)
+    {
+        if (options.output)
+            options.output->waitForRoom(seed);
+        return processSeed(seed, options);
+    };
+}
+
+// Every seed is a task (PoolExecutor). At most a few tasks per worker are
+// queued at a time, so the queue stays small whatever the number of seeds.
+void runThreadPool(HashSink const& store, Options const& options)
+{
+    PoolExecutor executor(options.nbThreads, placeWorkers(options));
+    Progress progress(options.nbSeeds);
+    executor.run(SeedRange{options.firstSeed, options.nbSeeds}, hashInWindow(options),
+                 [&store, &progress](size_t seed, uint64_t hash)
+    {
+        store(seed, hash);
+        progress.tick();
+    });
+    std::cout << std::endl;
+}
+
+// A thief takes the upper half of a range, far ahead of the output order:
+// with a streamed output, the seeds are shared a quarter of the reorder
+// window at a time (StealingExecutor).
+void runWorkStealing(HashSink const& store, Options const& options)
+{
+    size_t const step = options.output ? std::max<size_t>(options.output->window() / 4, 1) : 0;
+    StealingExecutor executor(options.nbThreads, step, placeWorkers(options));
+    Progress progress(options.nbSeeds);
+    executor.run(SeedRange{options.firstSeed, options.nbSeeds}, hashInWindow(options),
+                 [&store, &progress](size_t seed, uint64_t hash)
+    {
+        store(seed, hash);
+        progress.tick();
+    });
+    std::cout << std::endl;
+    executor.writeStats(std::cout);
+}
+
+using Clock = std::chrono::steady_clock;
+
+static void writeFinishTimes(std::vector<Clock::duration> const& finish)
+{
+    auto ms = [](Clock::duration d) { return std::chrono::duration_cast<std::chrono::milliseconds>(d).count(); };
+    auto range = std::minmax_element(finish.begin(), finish.end());
+    std::cout << "worker finish: first " << ms(*range.first) << " ms, last " << ms(*range.second)
+              << " ms, tail " << ms(*range.second - *range.first) << " ms" << std::endl;
+}
+
+// Shared queue ordered by decreasing predicted cost: the big seeds start
+// first and the small ones fill the gaps at the end. Unlike the other modes
+// it keeps a cost and an index per seed.
+void runLongestFirst(HashSink const& store, Options const& options)
+{
+    auto order = longestFirst(predictCosts(options));
+    std::atomic<size_t> next(0);
+    Progress progress(options.nbSeeds);
+    std::vector<Clock::duration> finish(options.nbThreads ? options.nbThreads : 1);
+    auto start = Clock::now();
+
+    std::vector<std::thread> workers;
+    for (size_t w = 0; w < finish.size(); ++w)
+    {
+        workers.emplace_back([&, w]
+        {
+            for (size_t k = next++; k < order.size(); k = next++)
+            {
+                size_t seed = options.firstSeed + order[k];
+                store(seed, processSeed(seed, options));
+                progress.tick();
+            }
+            finish[w] = Clock::now() - start;
+        });
+    }
+    for (auto& worker : workers)
+        worker.join();
+    std::cout << std::endl;
+    writeFinishTimes(finish);
+}
+
+// Static LPT packing: each worker runs its own bin, no shared state at all.
+void runLptBins(HashSink const& store, Options const& options)
+{
+    // no empty bin, nor idle worker, with more threads than seeds
+    auto bins = packBins(predictCosts(options), std::min<size_t>(options.nbThreads, options.nbSeeds));
+    Progress progress(options.nbSeeds);
+    std::vector<Clock::duration> finish(bins.tasks.size());
+    auto start = Clock::now();
+
+    std::vector<std::thread> workers;
+    for (size_t w = 0; w < bins.tasks.size(); ++w)
+    {
+        workers.emplace_back([&, w]
+        {
+            for (size_t index : bins.tasks[w])
+            {
+                size_t seed = options.firstSeed + index;
+                store(seed, processSeed(seed, options));
+                progress.tick();
+            }
+            finish[w] = Clock::now() - start;
+        });
+    }
+    for (auto& worker : workers)
+        worker.join();
+    std::cout << std::endl;
+
+    // over the bins with a predicted load, a seed of one number costs 0
+    std::vector<double> loads;
+    std::copy_if(bins.loads.begin(), bins.loads.end(), std::back_inserter(loads), [](double load) { return load > 0.; });
+    if (!loads.empty())
+    {
+        auto range = std::minmax_element(loads.begin(), loads.end());
+        std::cout << "predicted bin imbalance: " << (*range.second / *range.first - 1.) * 100. << "%" << std::endl;
+    }
+    writeFinishTimes(finish);
+}
+
+struct SeedNumbers
 {
-    std::mt19937 generator(seed);
+    size_t seed = 0;
     std::vector<uint32_t> numbers;
-    size_t nb = (generator() % 1000000) + 100000;
+    // set by an earlier stage when sort and hash are fused
+    bool hashed = false;
+    uint64_t hash = 0;
+    // admitted by the memory budget, released with the numbers
+    size_t footprint = 0;
+};
+
+struct StageStats
+{
+    std::atomic<size_t> items{0};
+    std::atomic<int64_t> busyNs{0};
+    std::atomic<size_t> starved{0};
+    std::atomic<size_t> blocked{0};
+};
+
+struct QueueOccupancy
+{
+    size_t samples = 0;
+    size_t total = 0;
+    size_t max = 0;
+
+    void sample(size_t size)
+    {
+        ++samples;
+        total += size;
+        max = std::max(max, size);
+    }
+};
 
-    numbers.reserve(nb);
-    for (size_t i = 0; i < nb; ++i)
+static void pushBlocking(BoundedQueue<SeedNumbers>& queue, SeedNumbers& item, StageStats& stats)
+{
+    while (!queue.try_push(item))
     {
-        numbers.emplace_back(generator());
+        ++stats.blocked;
+        std::this_thread::yield();
     }
-    return numbers;
 }
 
-void sortNumbers(std::vector<uint32_t>& numbers)
+// Returns false once the queue is empty and every upstream thread is done
+static bool popOrFinish(BoundedQueue<SeedNumbers>& queue, std::atomic<size_t> const& upstreamLeft,
+                        SeedNumbers& item, StageStats& stats)
 {
-    std::sort(numbers.begin(), numbers.end());
+    for (;;)
+    {
+        if (queue.try_pop(item))
+            return true;
+        if (upstreamLeft.load(std::memory_order_acquire) == 0)
+            return queue.try_pop(item);
+        ++stats.starved;
+        std::this_thread::yield();
+    }
 }
 
-uint64_t computeHash(std::vector<uint32_t> const& numbers)
+// generate -> sort -> hash, each stage with its own threads, connected by
+// bounded queues that move the vectors from one stage to the next.
+void runPipeline(HashSink const& store, Options const& options)
 {
-    uint64_t hash = numbers.size();
-    for (auto& i : numbers)
+    auto const& stageThreads = options.stageThreads;
+    static char const* const stageNames[3] = {"generate", "sort", "hash"};
+
+    BoundedQueue<SeedNumbers> toSort(options.queueCapacity);
+    BoundedQueue<SeedNumbers> toHash(options.queueCapacity);
+    std::array<StageStats, 3> stats;
+    std::array<std::atomic<size_t>, 2> threadsLeft;
+    threadsLeft[0] = stageThreads[0];
+    threadsLeft[1] = stageThreads[1];
+    std::atomic<size_t> next(0);
+    std::atomic<bool> finished(false);
+    Progress progress(options.nbSeeds);
+
+    auto timed = [](StageStats& stageStats, size_t items, auto&& work)
     {
-        hash ^= i + 0x9e3779b9f83da20c + (hash << 6) + (hash >> 2);
+        auto start = Clock::now();
+        work();
+        stageStats.busyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+        stageStats.items += items;
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < stageThreads[0]; ++t)
+    {
+        workers.emplace_back([&]
+        {
+            for (size_t i = next++; i < options.nbSeeds; i = next++)
+            {
+                SeedNumbers item;
+                item.seed = options.firstSeed + i;
+                if (options.output)
+                    options.output->waitForRoom(item.seed);
+                bool const cached = options.cache && options.cache->find(item.seed, workloadKey(options), item.hash);
+                if (!cached)
+                    item.footprint = admitSeed(item.seed, options);
+                // with a fused sort, the numbers leave this stage already sorted
+                timed(stats[0], 1, [&]
+                {
+                    if (cached)
+                        item.hashed = true;
+                    else if (options.fusion == Fusion::BucketsHash)
+                    {
+                        item.hash = generateSortHash(item.seed, item.numbers, options);
+                        item.hashed = true;
+                    }
+                    else if (options.fusion == Fusion::Buckets)
+                        item.numbers = sortedNumbers(item.seed, options);
+                    else
+                    {
+                        TraceSpan span(options.tracer, TraceStage::Generate, item.seed);
+                        item.numbers = generateWith(item.seed, options);
+                    }
+                });
+                pushBlocking(toSort, item, stats[0]);
+            }
+            --threadsLeft[0];
+        });
+    }
+    for (size_t t = 0; t < stageThreads[1]; ++t)
+    {
+        workers.emplace_back([&]
+        {
+            SeedNumbers item;
+            while (popOrFinish(toSort, threadsLeft[0], item, stats[1]))
+            {
+                timed(stats[1], 1, [&]
+                {
+                    // hashed by the generate stage, from the cache or fused
+                    if (item.hashed)
+                        return;
+                    if (options.fusion == Fusion::None)
+                    {
+                        TraceSpan span(options.tracer, TraceStage::Sort, item.seed);
+                        sortWith(options.sortEngine, item.numbers, !options.memoryBudget);
+                    }
+                });
+                pushBlocking(toHash, item, stats[1]);
+            }
+            --threadsLeft[1];
+        });
+    }
+    // With --hash-batch, the hash stage also takes whatever else is already
+    // waiting in its queue, up to the batch size, and hashes it in lockstep
+    for (size_t t = 0; t < stageThreads[2]; ++t)
+    {
+        workers.emplace_back([&]
+        {
+            std::vector<SeedNumbers> batch(options.hashBatch);
+            std::vector<std::vector<uint32_t> const*> arrays;
+            std::vector<uint64_t> hashes(options.hashBatch);
+            while (popOrFinish(toHash, threadsLeft[1], batch[0], stats[2]))
+            {
+                size_t count = 1;
+                while (count < batch.size() && toHash.try_pop(batch[count]))
+                    ++count;
+
+                // a batch is traced as one hash span, under its first seed
+                timed(stats[2], count, [&]
+                {
+                    TraceSpan span(count == 1 && batch[0].hashed ? nullptr : options.tracer, TraceStage::Hash, batch[0].seed);
+                    if (count == 1 && !batch[0].hashed)
+                    {
+                        batch[0].hash = computeHash(batch[0].numbers);
+                        return;
+                    }
+                    arrays.clear();
+                    for (size_t k = 0; k < count; ++k)
+                    {
+                        if (!batch[k].hashed)
+                            arrays.push_back(&batch[k].numbers);
+                    }
+                    BatchHash::hash(arrays.data(), arrays.size(), hashes.data());
+                    for (size_t k = 0, next = 0; k < count; ++k)
+                    {
+                        if (!batch[k].hashed)
+                            batch[k].hash = hashes[next++];
+                    }
+                });
+                for (size_t k = 0; k < count; ++k)
+                {
+                    if (options.cache)
+                        options.cache->insert(batch[k].seed, workloadKey(options), batch[k].hash);
+                    store(batch[k].seed, batch[k].hash);
+                    releaseNumbers(std::move(batch[k].numbers), options);
+                    if (batch[k].footprint)
+                        options.memoryBudget->release(batch[k].footprint);
+                    progress.tick();
+                }
+            }
+        });
+    }
+
+    // Sample the queues every millisecond while the pipeline runs
+    std::array<QueueOccupancy, 2> occupancy;
+    std::thread monitor([&]
+    {
+        while (!finished.load(std::memory_order_acquire))
+        {
+            occupancy[0].sample(toSort.size());
+            occupancy[1].sample(toHash.size());
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    auto start = Clock::now();
+    for (auto& worker : workers)
+        worker.join();
+    double wall = std::chrono::duration<double>(Clock::now() - start).count();
+    finished = true;
+    monitor.join();
+    std::cout << std::endl;
+
+    // items/s is what the stage sustains when it is never starved or blocked:
+    // the lowest one is the bottleneck.
+    std::cout << std::setw(10) << "stage" << std::setw(10) << "threads" << std::setw(10) << "items"
+              << std::setw(12) << "items/s" << std::setw(10) << "busy%" << std::setw(10) << "starved"
+              << std::setw(10) << "blocked" << std::endl;
+    for (size_t s = 0; s < 3; ++s)
+    {
+        double busy = static_cast<double>(stats[s].busyNs.load()) * 1e-9;
+        std::cout << std::setw(10) << stageNames[s] << std::setw(10) << stageThreads[s]
+                  << std::setw(10) << stats[s].items.load()
+                  << std::setw(12) << std::fixed << std::setprecision(1) << (busy > 0. ? stats[s].items.load() / busy * stageThreads[s] : 0.)
+                  << std::setw(10) << (wall > 0. ? busy * 100. / (wall * stageThreads[s]) : 0.)
+                  << std::setw(10) << stats[s].starved.load()
+                  << std::setw(10) << stats[s].blocked.load() << std::endl;
     }
-    return hash;
+    for (size_t q = 0; q < 2; ++q)
+    {
+        std::cout << "queue " << stageNames[q] << " -> " << stageNames[q + 1] << ": capacity " << toSort.capacity()
+                  << ", mean " << (occupancy[q].samples ? double(occupancy[q].total) / occupancy[q].samples : 0.)
+                  << ", max " << occupancy[q].max << std::endl;
+    }
+    std::cout.unsetf(std::ios_base::floatfield);
+    std::cout << std::setprecision(6);
 }
 
-void writeHashList(std::vector<uint64_t> const& hash_list)
+#if COROUTINES_AVAILABLE
+// One coroutine per seed, admitted by the caller. Every stage starts with a
+// hop back onto the pool, behind the stages already queued there, so the
+// stages of the seeds in flight interleave on the workers; a fused seed is
+// a single step.
+static DetachedTask hashSeedCoroutine(CoroScheduler& scheduler, OrderedResults& results, Options const& options,
+                                      size_t seed, size_t footprint)
 {
-    std::fstream output_file("output.txt", std::ios_base::out | std::ios_base::trunc);
-    for (auto hash : hash_list)
+    co_await scheduler.schedule();
+    uint64_t hash = 0;
+    if (!(options.cache && options.cache->find(seed, workloadKey(options), hash)))
     {
-        output_file << hash << "\n";
+        std::vector<uint32_t> numbers;
+        if (options.fusion != Fusion::None)
+            hash = generateSortHash(seed, numbers, options);
+        else
+        {
+            {
+                TraceSpan span(options.tracer, TraceStage::Generate, seed);
+                numbers = generateWith(seed, options);
+            }
+            co_await scheduler.schedule();
+            {
+                TraceSpan span(options.tracer, TraceStage::Sort, seed);
+                sortWith(options.sortEngine, numbers, !options.memoryBudget);
+            }
+            co_await scheduler.schedule();
+            TraceSpan span(options.tracer, TraceStage::Hash, seed);
+            hash = computeHash(numbers);
+        }
+        releaseNumbers(std::move(numbers), options);
+        if (options.cache)
+            options.cache->insert(seed, workloadKey(options), hash);
+    }
+    if (footprint)
+        options.memoryBudget->release(footprint);
+    results.complete(seed, hash);
+}
+
+// Takes the hashes in seed order, resumed by the seed it waits for
+static DetachedTask storeInOrder(OrderedResults& results, HashSink const& store, Progress& progress,
+                                 size_t firstSeed, size_t nbSeeds)
+{
+    for (size_t i = 0; i < nbSeeds; ++i)
+    {
+        uint64_t hash = co_await results.next();
+        store(firstSeed + i, hash);
+        progress.tick();
+    }
+}
+
+// The main thread starts the seed coroutines in order, at most a few per
+// worker ahead of the writer, and admits each under the memory budget:
+// nothing ever blocks a worker
+void runCoroutines(HashSink const& store, Options const& options)
+{
+    ThreadPool pool(options.nbThreads);
+    CoroScheduler scheduler(pool);
+    OrderedResults results(options.firstSeed);
+    Progress progress(options.nbSeeds);
+    size_t const window = 2 * pool.size();
+
+    storeInOrder(results, store, progress, options.firstSeed, options.nbSeeds);
+    for (size_t i = 0; i < options.nbSeeds; ++i)
+    {
+        size_t seed = options.firstSeed + i;
+        results.waitForRoom(seed, window);
+        hashSeedCoroutine(scheduler, results, options, seed, admitSeed(seed, options));
+    }
+    results.waitUntil(options.firstSeed + options.nbSeeds);
+    // the last seed returns from complete after the writer is done
+    pool.wait();
+    std::cout << std::endl;
+    std::cout << "coroutines: " << options.nbSeeds << " seeds, " << scheduler.hops() << " hops onto the pool"
+              << std::endl;
+}
+#endif
+
+bool runMode(std::string const& mode, HashSink const& store, Options const& options)
+{
+    if (mode == "pool")
+        runThreadPool(store, options);
+    else if (mode == "steal")
+        runWorkStealing(store, options);
+    else if (mode == "lpt")
+        runLongestFirst(store, options);
+    else if (mode == "lpt-bins")
+        runLptBins(store, options);
+    else if (mode == "pipeline")
+        runPipeline(store, options);
+    else if (mode == "coro")
+    {
+#if COROUTINES_AVAILABLE
+        runCoroutines(store, options);
+#else
+        std::cerr << "mode coro needs a C++20 build (-std=c++20)" << std::endl;
+        return false;
+#endif
+    }
+    else
+    {
+        std::cerr << "unknown mode " << mode << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Run every scheduler on the same seeds and compare their makespan, store
+// fills hash_list
+bool compareModes(std::vector<uint64_t>& hash_list, HashSink const& store, Options const& options)
+{
+    std::vector<std::string> modes = {"pool", "steal", "lpt", "lpt-bins"};
+#if COROUTINES_AVAILABLE
+    modes.push_back("coro");
+#endif
+    std::vector<long long> makespans;
+    std::vector<uint64_t> first;
+
+    for (auto const& mode : modes)
+    {
+        std::cout << "== " << mode << std::endl;
+        std::fill(hash_list.begin(), hash_list.end(), 0);
+        auto start = Clock::now();
+        runMode(mode, store, options);
+        makespans.push_back(std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count());
+
+        if (first.empty())
+            first = hash_list;
+        else if (first != hash_list)
+        {
+            std::cerr << mode << " does not produce the same hashes as " << modes[0] << std::endl;
+            return false;
+        }
+    }
+
+    std::cout << std::endl;
+    for (size_t i = 0; i < modes.size(); ++i)
+        std::cout << std::setw(10) << modes[i] << std::setw(10) << makespans[i] << " ms" << std::endl;
+    return true;
+}
+
+struct ResourceUsage
+{
+    size_t allocations = 0;
+    size_t allocatedBytes = 0;
+    long minorFaults = 0;
+    long majorFaults = 0;
+    long peakRssKb = 0;
+
+    static ResourceUsage now()
+    {
+        ResourceUsage usage;
+        usage.allocations = g_allocations.load();
+        usage.allocatedBytes = g_allocatedBytes.load();
+#ifdef __unix__
+        struct rusage ru;
+        if (::getrusage(RUSAGE_SELF, &ru) == 0)
+        {
+            usage.minorFaults = ru.ru_minflt;
+            usage.majorFaults = ru.ru_majflt;
+            usage.peakRssKb = ru.ru_maxrss;
+        }
+#endif
+        return usage;
+    }
+
+    void writeSince(ResourceUsage const& before, std::ostream& stream) const
+    {
+        stream << "allocations: " << (allocations - before.allocations)
+               << " (" << ((allocatedBytes - before.allocatedBytes) >> 20) << " MB)"
+               << ", page faults: " << (minorFaults - before.minorFaults) << " minor, "
+               << (majorFaults - before.majorFaults) << " major"
+               << ", peak RSS: " << (peakRssKb >> 10) << " MB" << std::endl;
+    }
+};
+
+// Compare two files line by line, report the first difference
+bool checkOutput(std::string const& path, std::string const& reference)
+{
+    std::ifstream output(path);
+    std::ifstream expected(reference);
+    if (!output || !expected)
+    {
+        std::cerr << "check: cannot open " << (output ? reference : path) << std::endl;
+        return false;
+    }
+
+    std::string line;
+    std::string expectedLine;
+    size_t lineNumber = 1;
+    for (;; ++lineNumber)
+    {
+        bool hasLine = static_cast<bool>(std::getline(output, line));
+        bool hasExpected = static_cast<bool>(std::getline(expected, expectedLine));
+        if (!hasLine && !hasExpected)
+            return true;
+        if (hasLine != hasExpected || line != expectedLine)
+        {
+            std::cerr << "check: " << path << " differs from " << reference
+                      << " at line " << lineNumber << std::endl;
+            return false;
+        }
     }
 }
 
-int main(int, char**)
+// Usage: main [--seeds count] [--first seed] [--sizes min,max] [--output path]
+//             [-j threads] [--mode pool|steal|lpt|lpt-bins|pipeline|coro|compare]
+//             [--stages g,s,h] [--queue capacity] [--hash-batch count]
+//             [--sort std|radix|simd]
+//             [--generator std|simd] [--fuse none|buckets|buckets-hash]
+//             [--buckets count] [--buffers fresh|pool] [--hugepages]
+//             [--write stream|end] [--cache path] [--cache-entries count]
+//             [--processes count] [--process-memory MB] [--trace path]
+//             [--memory-budget MB] [--pin] [--check [reference]]
+//   --seeds: number of seeds (1000), up to 2^32 - 1
+//   --first: first seed (0)
+//   --sizes: a seed has min to max - 1 numbers (100000,1100000)
+//   --output: file of the hashes (output.txt)
+//   -j: number of worker threads, defaults to the number of cores
+//   --mode: shared FIFO thread pool (default), work stealing, largest
+//           predicted seed first, static LPT bins, staged pipeline, one
+//           C++20 coroutine per seed on a thread pool or all but pipeline
+//           in a row
+//   --stages: threads of the generate, sort and hash stages (2,4,1)
+//   --queue: capacity of the queues between pipeline stages (8)
+//   --hash-batch: sorted arrays the pipeline hash stage hashes together,
+//                 up to 8 chains in lockstep (1)
+//   --sort: std::sort (default), 11-bit LSD radix sort or AVX2 quicksort
+//   --generator: std::mt19937 (default) or the SIMD MT19937, same sequence
+//   --fuse: buckets generates each value straight into a bucket of its top
+//           bits and sorts the buckets one by one (--buckets 256 to 4096),
+//           buckets-hash also hashes every bucket right after its sort.
+//           --sort sorts the buckets
+//   --buffers: allocate a vector per seed (fresh, default) or recycle them
+//   --hugepages: advise transparent huge pages on recycled buffers
+//   --write: stream the output in seed order while the seeds complete, in
+//            constant memory (default), or keep every hash and write them
+//            at the end, with writeHashList for output.txt. compare, lpt
+//            and lpt-bins keep per-seed state whatever the write mode
+//   --cache: file of the seed hashes kept between runs, shared by
+//            concurrent runs, seeds found there are not recomputed
+//   --cache-entries: slots of a new cache file, 32 bytes each (1048576)
+//   --processes: fork count processes, each running --mode with -j threads
+//                on its shard of the seeds, results in shared memory
+//   --process-memory: address space limit of each process; a process that
+//                     crashes is restarted once on its shard
+//   --trace: write the start and end of every stage of every seed as a
+//            Chrome trace (chrome://tracing, ui.perfetto.dev) and print the
+//            p50/p99 duration of each stage
+//   --memory-budget: numbers and sort scratch of the seeds in flight, each
+//                    seed waits until its predicted share fits (per process)
+//   --pin: pool and steal workers pinned to CPUs spread over the NUMA
+//          nodes, each with its own buffer arena; seeds/s per node. Nothing
+//          is pinned on a single node machine
+//   --check: compare the output with reference (output_good.txt)
+int main(int argc, char** argv)
 {
+    Options options;
+    std::string mode = "pool";
+    std::string buffers = "fresh";
+    bool hugePages = false;
+    std::string write = "stream";
+    std::string outputPath = "output.txt";
+    std::string cachePath;
+    size_t cacheEntries = 1 << 20;
+    size_t processes = 0;
+    size_t processMemoryMb = 0;
+    size_t memoryBudgetMb = 0;
+    std::string tracePath;
+    bool pin = false;
+    bool bucketsSet = false;
+    bool check = false;
+    std::string reference = "output_good.txt";
+
+    auto usage = [argv]()
+    {
+        std::cerr << "usage: " << argv[0] << " [--seeds count] [--first seed] [--sizes min,max] [--output path]"
+                  << " [-j threads] [--mode pool|steal|lpt|lpt-bins|pipeline|coro|compare]"
+                  << " [--stages g,s,h] [--queue capacity] [--hash-batch count] [--sort std|radix|simd]"
+                  << " [--generator std|simd] [--fuse none|buckets|buckets-hash] [--buckets count]"
+                  << " [--buffers fresh|pool] [--hugepages] [--write stream|end]"
+                  << " [--cache path] [--cache-entries count] [--processes count] [--process-memory MB]"
+                  << " [--trace path] [--memory-budget MB] [--pin] [--check [reference]]" << std::endl;
+    };
+
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg == "--seeds" && i + 1 < argc)
+                options.nbSeeds = std::stoul(argv[++i]);
+            else if (arg == "--first" && i + 1 < argc)
+                options.firstSeed = std::stoul(argv[++i]);
+            else if (arg == "--sizes" && i + 1 < argc)
+            {
+                size_t minSize = 0;
+                size_t maxSize = 0;
+                if (std::sscanf(argv[++i], "%zu,%zu", &minSize, &maxSize) != 2 || !minSize || maxSize <= minSize)
+                {
+                    std::cerr << "--sizes expects min,max with 0 < min < max, e.g. 100000,1100000" << std::endl;
+                    return 1;
+                }
+                options.minSize = minSize;
+                options.sizeSpread = maxSize - minSize;
+            }
+            else if (arg == "--output" && i + 1 < argc)
+                outputPath = argv[++i];
+            else if (arg == "-j" && i + 1 < argc)
+                options.nbThreads = std::stoul(argv[++i]);
+            else if (arg == "--stages" && i + 1 < argc)
+            {
+                auto& stages = options.stageThreads;
+                if (std::sscanf(argv[++i], "%zu,%zu,%zu", &stages[0], &stages[1], &stages[2]) != 3
+                    || !stages[0] || !stages[1] || !stages[2])
+                {
+                    std::cerr << "--stages expects three thread counts, e.g. 2,4,1" << std::endl;
+                    return 1;
+                }
+            }
+            else if (arg == "--queue" && i + 1 < argc)
+                options.queueCapacity = std::stoul(argv[++i]);
+            else if (arg == "--hash-batch" && i + 1 < argc)
+            {
+                options.hashBatch = std::stoul(argv[++i]);
+                if (!options.hashBatch)
+                {
+                    std::cerr << "--hash-batch expects at least 1" << std::endl;
+                    return 1;
+                }
+            }
+            else if (arg == "--sort" && i + 1 < argc)
+            {
+                std::string engine = argv[++i];
+                if (engine == "std")
+                    options.sortEngine = SortEngine::Std;
+                else if (engine == "radix")
+                    options.sortEngine = SortEngine::Radix;
+                else if (engine == "simd")
+                    options.sortEngine = SortEngine::Simd;
+                else
+                {
+                    std::cerr << "unknown sort engine " << engine << std::endl;
+                    return 1;
+                }
+            }
+            else if (arg == "--mode" && i + 1 < argc)
+                mode = argv[++i];
+            else if (arg == "--generator" && i + 1 < argc)
+            {
+                std::string engine = argv[++i];
+                if (engine == "std")
+                    options.generatorEngine = GeneratorEngine::Std;
+                else if (engine == "simd")
+                    options.generatorEngine = GeneratorEngine::Simd;
+                else
+                {
+                    std::cerr << "unknown generator " << engine << std::endl;
+                    return 1;
+                }
+            }
+            else if (arg == "--fuse" && i + 1 < argc)
+            {
+                std::string fusion = argv[++i];
+                if (fusion == "none")
+                    options.fusion = Fusion::None;
+                else if (fusion == "buckets")
+                    options.fusion = Fusion::Buckets;
+                else if (fusion == "buckets-hash")
+                    options.fusion = Fusion::BucketsHash;
+                else
+                {
+                    std::cerr << "unknown fusion " << fusion << std::endl;
+                    return 1;
+                }
+            }
+            else if (arg == "--buckets" && i + 1 < argc)
+            {
+                size_t count = std::stoul(argv[++i]);
+                options.bucketBits = 0;
+                while ((size_t(1) << options.bucketBits) < count)
+                    ++options.bucketBits;
+                if (options.bucketBits < 8 || options.bucketBits > 12 || (size_t(1) << options.bucketBits) != count)
+                {
+                    std::cerr << "--buckets expects a power of two from 256 to 4096" << std::endl;
+                    return 1;
+                }
+                bucketsSet = true;
+            }
+            else if (arg == "--buffers" && i + 1 < argc)
+                buffers = argv[++i];
+            else if (arg == "--hugepages")
+                hugePages = true;
+            else if (arg == "--write" && i + 1 < argc)
+            {
+                write = argv[++i];
+                if (write != "stream" && write != "end")
+                {
+                    std::cerr << "unknown write mode " << write << std::endl;
+                    return 1;
+                }
+            }
+            else if (arg == "--cache" && i + 1 < argc)
+                cachePath = argv[++i];
+            else if (arg == "--cache-entries" && i + 1 < argc)
+                cacheEntries = std::stoul(argv[++i]);
+            else if (arg == "--processes" && i + 1 < argc)
+                processes = std::stoul(argv[++i]);
+            else if (arg == "--process-memory" && i + 1 < argc)
+                processMemoryMb = std::stoul(argv[++i]);
+            else if (arg == "--memory-budget" && i + 1 < argc)
+                memoryBudgetMb = std::stoul(argv[++i]);
+            else if (arg == "--pin")
+                pin = true;
+            else if (arg == "--trace" && i + 1 < argc)
+                tracePath = argv[++i];
+            else if (arg == "--check")
+            {
+                check = true;
+                if (i + 1 < argc && argv[i + 1][0] != '-')
+                    reference = argv[++i];
+            }
+            else
+            {
+                usage();
+                return 1;
+            }
+        }
+    }
+    catch (std::logic_error const&)
+    {
+        // std::stoul on a value that is not a number, or too large
+        usage();
+        return 1;
+    }
+
+    BufferPool bufferPool(hugePages);
+    if (buffers == "pool")
+        options.bufferPool = &bufferPool;
+    else if (buffers != "fresh")
+    {
+        std::cerr << "unknown buffer mode " << buffers << std::endl;
+        return 1;
+    }
+
+    // seeds are 32-bit for both generators, and work stealing packs two
+    // seed indices in 64 bits
+    if (!options.nbSeeds || options.firstSeed + options.nbSeeds > (uint64_t(1) << 32))
+    {
+        std::cerr << "the seed range must be non-empty and below 2^32" << std::endl;
+        return 1;
+    }
+
+    if (bucketsSet && options.fusion == Fusion::None)
+    {
+        std::cerr << "--buckets sets the buckets of --fuse, it has no effect without it" << std::endl;
+        return 1;
+    }
+    if (processes && mode == "compare")
+    {
+        std::cerr << "--processes runs a single mode, not compare" << std::endl;
+        return 1;
+    }
+    if (processes && !tracePath.empty())
+    {
+        std::cerr << "--trace records the threads of a single process, not --processes" << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<MemoryBudget> memoryBudget;
+    if (memoryBudgetMb)
+    {
+        memoryBudget.reset(new MemoryBudget(memoryBudgetMb << 20));
+        options.memoryBudget = memoryBudget.get();
+#ifdef __GLIBC__
+        // large freed blocks go back to the system, instead of staying in the
+        // heap once glibc raised its mmap threshold
+        mallopt(M_MMAP_THRESHOLD, 128 * 1024);
+#endif
+    }
+
+    if (pin && ((mode != "pool" && mode != "steal") || processes))
+    {
+        std::cerr << "--pin places the workers of the pool and steal modes, in a single process" << std::endl;
+        return 1;
+    }
+    std::unique_ptr<WorkerPlacement> placement;
+    if (pin)
+    {
+        placement.reset(new WorkerPlacement(CpuTopology::detect(), options.nbThreads, hugePages));
+        options.placement = placement.get();
+    }
+
+    std::unique_ptr<Tracer> tracer;
+    if (!tracePath.empty())
+    {
+        tracer.reset(new Tracer());
+        options.tracer = tracer.get();
+    }
+
+    HashCache cache;
+    if (!cachePath.empty())
+    {
+        if (!cache.open(cachePath, cacheEntries))
+        {
+            std::cerr << "cannot open the hash cache " << cachePath << std::endl;
+            return 1;
+        }
+        options.cache = &cache;
+    }
+
+    // compare and --write end keep every hash in hash_list, otherwise each
+    // one goes to the output as soon as all the seeds before it are done
     std::vector<uint64_t> hash_list;
+    std::unique_ptr<OrderedWriter> writer;
+    HashSink store;
+    if (write == "stream" && mode != "compare")
+    {
+        writer.reset(new OrderedWriter(outputPath, options.firstSeed));
+        if (!writer->isOpen())
+        {
+            std::cerr << "cannot open " << outputPath << std::endl;
+            return 1;
+        }
+        OrderedWriter* streamed = writer.get();
+        Tracer* const tracing = options.tracer;
+        store = [streamed, tracing](size_t seed, uint64_t hash)
+        {
+            TraceSpan span(tracing, TraceStage::Write, seed);
+            streamed->push(seed, hash);
+        };
+        options.output = streamed;
+    }
+    else
+    {
+        hash_list.resize(options.nbSeeds);
+        size_t const first = options.firstSeed;
+        store = [&hash_list, first](size_t seed, uint64_t hash) { hash_list[seed - first] = hash; };
+    }
 
-    for (size_t i = 0; i < 1000; ++i)
+    if (mode == "compare")
+    {
+        if (!compareModes(hash_list, store, options))
+            return 2;
+    }
+    else if (processes)
+    {
+        // every child runs the selected mode on its shard, in place of the
+        // executor's hashSeed; the hashes are then stored in seed order,
+        // from the shared array
+        auto usage = ResourceUsage::now();
+        auto start = Clock::now();
+        ProcessExecutor executor(processes, [&mode, &options](SeedRange shard, SeedExecutor::HashSeed const&,
+                                                               HashSink const& shardStore)
+        {
+            Options shardOptions = options;
+            shardOptions.firstSeed = shard.first;
+            shardOptions.nbSeeds = shard.count;
+            shardOptions.output = nullptr;
+            return runMode(mode, shardStore, shardOptions);
+        }, processMemoryMb);
+        executor.showProgress(true);
+        auto hashSeed = [&options](size_t seed) { return processSeed(seed, options); };
+        if (!executor.run(SeedRange{options.firstSeed, options.nbSeeds}, hashSeed, store))
+            return 2;
+        std::cout << "makespan: "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count()
+                  << " ms" << std::endl;
+        ResourceUsage::now().writeSince(usage, std::cout);
+    }
+    else
+    {
+        auto usage = ResourceUsage::now();
+        auto start = Clock::now();
+        if (!runMode(mode, store, options))
+            return 1;
+        auto elapsed = Clock::now() - start;
+        std::cout << std::endl << "makespan: "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()
+                  << " ms" << std::endl;
+        ResourceUsage::now().writeSince(usage, std::cout);
+        if (placement)
+            placement->writeStats(std::cout, std::chrono::duration<double>(elapsed).count());
+    }
+    if (options.cache)
+    {
+        std::cout << "cache: " << cache.hits() << " hits, " << cache.misses() << " misses, "
+                  << cache.stored() << " stored in " << cache.capacity() << " slots"
+                  << (cache.wasReset() ? " (new file)" : "") << std::endl;
+    }
+    // the children of --processes keep their own budget and counters
+    if (memoryBudget && !processes)
     {
-        auto numbers = generateNumbers(i);
-        sortNumbers(numbers);
-        hash_list.push_back(computeHash(numbers));
+        std::cout << "memory budget: peak " << (memoryBudget->peak() >> 20) << " MB of "
+                  << (memoryBudget->budget() >> 20) << " MB admitted, " << memoryBudget->waits()
+                  << " seeds waited, " << memoryBudget->oversized() << " over the whole budget" << std::endl;
+    }
+    if (tracer)
+    {
+        tracer->writeSummary(std::cout);
+        if (!tracer->writeChromeTrace(tracePath))
+        {
+            std::cerr << "cannot write the trace " << tracePath << std::endl;
+            return 2;
+        }
+        std::cout << "trace: " << tracePath << std::endl;
+    }
 
-        if ((i % 100) == 0)
+    if (!writer && outputPath == "output.txt")
+        writeHashList(hash_list);
+    else
+    {
+        if (!writer)
+        {
+            writer.reset(new OrderedWriter(outputPath, options.firstSeed));
+            for (size_t i = 0; i < hash_list.size(); ++i)
+                writer->push(options.firstSeed + i, hash_list[i]);
+        }
+        if (!writer->close() || writer->next() != options.firstSeed + options.nbSeeds)
         {
-            std::cout << '\r' << (i / 10) << "%";
+            std::cerr << outputPath << ": write failed after seed " << writer->next() << std::endl;
+            return 2;
         }
+        std::cout << outputPath << ": " << writer->writes() << " writes, at most " << writer->peakAhead()
+                  << " seeds waiting beyond the reorder window" << std::endl;
     }
 
-    writeHashList(hash_list);
+    if (check)
+    {
+        if (!checkOutput(outputPath, reference))
+            return 2;
+        std::cout << outputPath << " matches " << reference << std::endl;
+    }
 
     return 0;
-}
\ No newline at end of file
+}
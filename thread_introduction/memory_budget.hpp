@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+
+// Admission control on the memory of the tasks in flight: a task announces
+// its predicted footprint before it allocates and waits until it fits in
+// the budget next to the tasks already admitted, so the peak stays under
+// the budget whatever the number of threads.
+//
+// Tasks are admitted in the order they ask, a large one is not overtaken
+// forever by small ones. A task larger than the whole budget is admitted
+// alone, once nothing else is in flight.
+class MemoryBudget
+{
+public:
+    explicit MemoryBudget(size_t bytes)
+        : _budget(bytes)
+    {}
+
+    MemoryBudget(MemoryBudget const&) = delete;
+    MemoryBudget& operator=(MemoryBudget const&) = delete;
+
+    void acquire(size_t bytes)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        uint64_t ticket = _nextTicket++;
+        auto admitted = [this, ticket, bytes]
+        {
+            return ticket == _serving && (_used == 0 || _used + bytes <= _budget);
+        };
+        if (!admitted())
+        {
+            ++_waits;
+            _changed.wait(lock, admitted);
+        }
+        if (bytes > _budget)
+            ++_oversized;
+        _used += bytes;
+        _peak = std::max(_peak, _used);
+        ++_serving;
+        // the next ticket may fit as well
+        _changed.notify_all();
+    }
+
+    void release(size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _used -= bytes;
+        _changed.notify_all();
+    }
+
+    size_t budget() const { return _budget; }
+
+    // Most bytes admitted at the same time
+    size_t peak() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _peak;
+    }
+
+    // Tasks that had to wait for their admission
+    size_t waits() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _waits;
+    }
+
+    // Tasks larger than the whole budget, run alone
+    size_t oversized() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _oversized;
+    }
+
+private:
+    size_t _budget;
+    size_t _used = 0;
+    size_t _peak = 0;
+    size_t _waits = 0;
+    size_t _oversized = 0;
+    uint64_t _nextTicket = 0;
+    uint64_t _serving = 0;
+    mutable std::mutex _mutex;
+    std::condition_variable _changed;
+};
@@ -0,0 +1,283 @@
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <chrono>
+#include <string>
+#include <algorithm>
+#include <thread>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Runs the thread_introduction program once per mode, engine and thread
+// count, each run in its own process with --check against the reference, so
+// a faster engine only counts when its output is still right. Prints seeds/s,
+// the speedup over the serial run of the same engine (pool mode, one
+// thread, 0 when serial is not run), the parallel efficiency and the peak
+// RSS of every run, as a table and as JSON. Exits with 2 when any run fails.
+//
+// Usage: mode_bench [--binary path] [--modes serial,pool,steal,pipeline]
+//                   [--engines std,radix,simd-mt,radix+simd-mt]
+//                   [--threads 1,2,4] [--repeat count]
+//                   [--reference output_good.txt] [--json mode_bench.json]
+//   --modes: any --mode of the program, serial being pool with -j 1. The
+//            pipeline runs its three stages on the thread count, one hash
+//            thread and a third of the rest generating
+//   --engines: std::mt19937 and std::sort, the radix sort, the SIMD MT19937
+//              generator, or both
+//   --threads: thread counts of every mode but serial (1,2,4,... up to the
+//              number of cores)
+//   --repeat: runs of each configuration, the fastest is kept and every
+//             one is checked (1)
+
+struct Run
+{
+    std::string mode;
+    std::string engine;
+    size_t threads = 1;     // worker threads, all stages of the pipeline
+    double seconds = 0.;
+    long peakRssKb = 0;
+    bool correct = false;
+    double speedup = 0.;
+};
+
+static std::vector<std::string> splitList(std::string const& list)
+{
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (!item.empty())
+            items.push_back(item);
+    }
+    return items;
+}
+
+static std::vector<std::string> engineArgs(std::string const& engine)
+{
+    if (engine == "radix")
+        return {"--sort", "radix"};
+    if (engine == "simd-mt")
+        return {"--generator", "simd"};
+    if (engine == "radix+simd-mt")
+        return {"--sort", "radix", "--generator", "simd"};
+    return {};
+}
+
+static std::vector<std::string> modeArgs(std::string const& mode, size_t threads)
+{
+    if (mode == "serial")
+        return {"--mode", "pool", "-j", "1"};
+    if (mode == "pipeline")
+    {
+        size_t generate = std::max<size_t>(1, (threads - 1) / 3);
+        size_t sort = threads > generate + 1 ? threads - generate - 1 : 1;
+        return {"--mode", "pipeline", "--stages",
+                std::to_string(generate) + "," + std::to_string(sort) + ",1"};
+    }
+    return {"--mode", mode, "-j", std::to_string(threads)};
+}
+
+// Threads doing the work of a run, for its efficiency
+static size_t workerCount(std::string const& mode, size_t threads)
+{
+    if (mode == "serial")
+        return 1;
+    if (mode == "pipeline")
+    {
+        std::vector<std::string> args = modeArgs(mode, threads);
+        size_t total = 0;
+        for (auto const& stage : splitList(args.back()))
+            total += std::stoul(stage);
+        return total;
+    }
+    return threads;
+}
+
+// Runs binary with args, its output to /dev/null; false unless it exits
+// with 0
+static bool runChild(std::string const& binary, std::vector<std::string> const& args, double& seconds, long& peakRssKb)
+{
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(binary.c_str()));
+    for (auto const& arg : args)
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = ::fork();
+    if (pid < 0)
+        return false;
+    if (pid == 0)
+    {
+        int null = ::open("/dev/null", O_WRONLY);
+        if (null >= 0)
+            ::dup2(null, STDOUT_FILENO);
+        ::execv(binary.c_str(), argv.data());
+        ::_exit(127);
+    }
+
+    int status = 0;
+    struct rusage usage = {};
+    if (::wait4(pid, &status, 0, &usage) != pid)
+        return false;
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    peakRssKb = usage.ru_maxrss;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void writeJson(std::ostream& stream, std::vector<Run> const& runs, size_t nbSeeds)
+{
+    stream << "{\n  \"seeds\": " << nbSeeds << ",\n  \"runs\": [";
+    for (size_t i = 0; i < runs.size(); ++i)
+    {
+        Run const& run = runs[i];
+        stream << (i ? ",\n" : "\n") << "    {\"mode\": \"" << run.mode << "\", \"engine\": \"" << run.engine
+               << "\", \"threads\": " << run.threads << ", \"correct\": " << (run.correct ? "true" : "false")
+               << ", \"seconds\": " << run.seconds << ", \"seeds_per_second\": " << nbSeeds / run.seconds
+               << ", \"speedup\": " << run.speedup << ", \"efficiency\": " << run.speedup / run.threads
+               << ", \"peak_rss_kb\": " << run.peakRssKb << "}";
+    }
+    stream << "\n  ]\n}\n";
+}
+
+int main(int argc, char** argv)
+{
+    std::string binary = "./thread_introduction";
+    std::vector<std::string> modes = {"serial", "pool", "steal", "pipeline"};
+    std::vector<std::string> engines = {"std", "radix", "simd-mt", "radix+simd-mt"};
+    std::vector<size_t> threadCounts;
+    std::string reference = "output_good.txt";
+    std::string jsonPath = "mode_bench.json";
+    size_t nbRepeats = 1;
+
+    for (size_t cores = std::max(1u, std::thread::hardware_concurrency()), t = 1;; t *= 2)
+    {
+        threadCounts.push_back(std::min(t, cores));
+        if (t >= cores)
+            break;
+    }
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--binary" && i + 1 < argc)
+            binary = argv[++i];
+        else if (arg == "--modes" && i + 1 < argc)
+            modes = splitList(argv[++i]);
+        else if (arg == "--engines" && i + 1 < argc)
+            engines = splitList(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            threadCounts.clear();
+            for (auto const& count : splitList(argv[++i]))
+                threadCounts.push_back(std::max<size_t>(1, std::stoul(count)));
+        }
+        else if (arg == "--reference" && i + 1 < argc)
+            reference = argv[++i];
+        else if (arg == "--json" && i + 1 < argc)
+            jsonPath = argv[++i];
+        else if (arg == "--repeat" && i + 1 < argc)
+            nbRepeats = std::max<size_t>(1, std::stoul(argv[++i]));
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--binary path] [--modes list] [--engines list]"
+                      << " [--threads list] [--repeat count] [--reference path] [--json path]" << std::endl;
+            return 1;
+        }
+    }
+    for (auto const& engine : engines)
+    {
+        if (engine != "std" && engineArgs(engine).empty())
+        {
+            std::cerr << "unknown engine " << engine << std::endl;
+            return 1;
+        }
+    }
+
+    // the reference fixes the seeds: the defaults of the program
+    size_t nbSeeds = 0;
+    {
+        std::ifstream file(reference);
+        if (!file)
+        {
+            std::cerr << "cannot open " << reference << std::endl;
+            return 1;
+        }
+        std::string line;
+        while (std::getline(file, line))
+            ++nbSeeds;
+    }
+    std::string const outputPath = "mode_bench_output.txt";
+
+    std::vector<Run> runs;
+    bool allCorrect = true;
+    std::cout << std::setw(10) << "mode" << std::setw(16) << "engine" << std::setw(9) << "threads"
+              << std::setw(10) << "seeds/s" << std::setw(10) << "speedup" << std::setw(12) << "efficiency"
+              << std::setw(10) << "RSS MB" << std::setw(8) << "check" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for (auto const& engine : engines)
+    {
+        double serialSeconds = 0.;
+        for (auto const& mode : modes)
+        {
+            std::vector<std::string> lastArgs;
+            for (size_t threads : mode == "serial" ? std::vector<size_t>{1} : threadCounts)
+            {
+                std::vector<std::string> args = modeArgs(mode, threads);
+                // the pipeline has the same stages for 1 and 2 threads
+                if (args == lastArgs)
+                    continue;
+                lastArgs = args;
+                for (auto const& arg : engineArgs(engine))
+                    args.push_back(arg);
+                for (auto const& arg : {std::string("--output"), outputPath, std::string("--check"), reference})
+                    args.push_back(arg);
+
+                Run run;
+                run.mode = mode;
+                run.engine = engine;
+                run.threads = workerCount(mode, threads);
+                run.correct = true;
+                run.seconds = 0.;
+                for (size_t r = 0; r < nbRepeats; ++r)
+                {
+                    double seconds = 0.;
+                    long peakRssKb = 0;
+                    run.correct = runChild(binary, args, seconds, peakRssKb) && run.correct;
+                    if (r == 0 || seconds < run.seconds)
+                        run.seconds = seconds;
+                    run.peakRssKb = std::max(run.peakRssKb, peakRssKb);
+                }
+                allCorrect = allCorrect && run.correct;
+                if (mode == "serial" && run.correct)
+                    serialSeconds = run.seconds;
+                run.speedup = serialSeconds > 0. ? serialSeconds / run.seconds : 0.;
+                runs.push_back(run);
+
+                std::cout << std::setw(10) << mode << std::setw(16) << engine << std::setw(9) << run.threads
+                          << std::setw(10) << nbSeeds / run.seconds << std::setw(10) << run.speedup
+                          << std::setw(12) << run.speedup / run.threads << std::setw(10) << run.peakRssKb / 1024.
+                          << std::setw(8) << (run.correct ? "ok" : "FAILED") << std::endl;
+            }
+        }
+    }
+    std::remove(outputPath.c_str());
+
+    std::ofstream json(jsonPath);
+    writeJson(json, runs, nbSeeds);
+    std::cout << "results in " << jsonPath << std::endl;
+    if (!allCorrect)
+    {
+        std::cerr << "some runs failed or did not match " << reference << std::endl;
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Writes the hash of every seed, one decimal per line in seed order, as the
+// seeds complete in any order: same bytes as writeHashList, without keeping
+// the whole list until the end.
+//
+// A hash lands in a ring of window slots; whenever the next seed in sequence
+// is there, it and every following ready slot are formatted with to_chars
+// into a large buffer. The buffer goes out in a single fwrite on an
+// unbuffered FILE (one write syscall) once it is full or a second old, so
+// the file grows progressively. A seed more than window ahead of the next
+// one waits in a map instead: schedulers taking the seeds roughly in order
+// call waitForRoom before taking one, so it never happens to them.
+class OrderedWriter
+{
+public:
+    OrderedWriter(std::string const& path, size_t firstSeed, size_t window = 4096, size_t bufferSize = 1 << 20)
+        : _file(std::fopen(path.c_str(), "wb"))
+        , _next(firstSeed)
+        , _slots(window)
+        , _bufferSize(bufferSize)
+        , _lastFlush(Clock::now())
+    {
+        if (_file)
+            std::setvbuf(_file, nullptr, _IONBF, 0);
+        _buffer.reserve(bufferSize + maxLineSize);
+    }
+
+    ~OrderedWriter()
+    {
+        close();
+    }
+
+    OrderedWriter(OrderedWriter const&) = delete;
+    OrderedWriter& operator=(OrderedWriter const&) = delete;
+
+    bool isOpen() const { return _file != nullptr; }
+
+    void push(size_t seed, uint64_t hash)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (seed - _next < _slots.size())
+        {
+            Slot& slot = _slots[seed % _slots.size()];
+            slot.hash = hash;
+            slot.ready = true;
+        }
+        else
+        {
+            _ahead.emplace(seed, hash);
+            _peakAhead = std::max(_peakAhead, _ahead.size());
+        }
+        if (seed == _next)
+            drain();
+    }
+
+    // Blocks until seed fits in the reorder window. Only the thread about to
+    // take seed may wait here, the ones holding earlier seeds must not.
+    void waitForRoom(size_t seed)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _room.wait(lock, [this, seed] { return seed - _next < _slots.size(); });
+    }
+
+    size_t window() const { return _slots.size(); }
+
+    // Writes what is buffered, returns false if a write failed
+    bool close()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_file)
+            return false;
+        flush();
+        bool ok = !_failed && std::fclose(_file) == 0;
+        _file = nullptr;
+        return ok;
+    }
+
+    // Next seed not written yet
+    size_t next() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _next;
+    }
+
+    size_t writes() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _writes;
+    }
+
+    // Most seeds that waited outside the window at the same time
+    size_t peakAhead() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _peakAhead;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // 20 digits and the newline
+    static const size_t maxLineSize = 21;
+
+    struct Slot
+    {
+        uint64_t hash = 0;
+        bool ready = false;
+    };
+
+    void drain()
+    {
+        for (;;)
+        {
+            Slot& slot = _slots[_next % _slots.size()];
+            if (slot.ready)
+            {
+                slot.ready = false;
+                append(slot.hash);
+            }
+            else
+            {
+                auto ahead = _ahead.find(_next);
+                if (ahead == _ahead.end())
+                    break;
+                append(ahead->second);
+                _ahead.erase(ahead);
+            }
+            ++_next;
+            if (_buffer.size() >= _bufferSize)
+                flush();
+        }
+        _room.notify_all();
+        if (Clock::now() - _lastFlush > std::chrono::seconds(1))
+            flush();
+
+        // seeds waiting in the map that entered the window
+        while (!_ahead.empty() && _ahead.begin()->first - _next < _slots.size())
+        {
+            auto ahead = _ahead.begin();
+            Slot& slot = _slots[ahead->first % _slots.size()];
+            slot.hash = ahead->second;
+            slot.ready = true;
+            _ahead.erase(ahead);
+        }
+    }
+
+    void append(uint64_t hash)
+    {
+        size_t size = _buffer.size();
+        _buffer.resize(size + maxLineSize);
+        char* end = std::to_chars(&_buffer[size], &_buffer[size] + maxLineSize - 1, hash).ptr;
+        *end++ = '\n';
+        _buffer.resize(static_cast<size_t>(end - _buffer.data()));
+    }
+
+    void flush()
+    {
+        _lastFlush = Clock::now();
+        if (_buffer.empty() || !_file)
+            return;
+        if (std::fwrite(_buffer.data(), 1, _buffer.size(), _file) != _buffer.size())
+            _failed = true;
+        ++_writes;
+        _buffer.clear();
+    }
+
+    std::FILE* _file;
+    size_t _next;
+    std::vector<Slot> _slots;
+    std::map<size_t, uint64_t> _ahead;
+    std::vector<char> _buffer;
+    size_t _bufferSize;
+    Clock::time_point _lastFlush;
+    size_t _writes = 0;
+    size_t _peakAhead = 0;
+    bool _failed = false;
+    mutable std::mutex _mutex;
+    std::condition_variable _room;
+};
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <vector>
+
+#ifdef __unix__
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Splits a seed range in contiguous shards, one forked process each. The
+// children write their hashes in a uint64_t array of a shared anonymous
+// mapping and count the seeds done in it; the parent only watches those
+// counters. A child that crashes or is killed, by its memory limit for
+// instance, does not take the others down: its shard is run again by a new
+// child, up to retries times.
+//
+// POSIX only, run() fails elsewhere. Fork from a single threaded process.
+class ProcessShards
+{
+public:
+    using Store = std::function<void(size_t seed, uint64_t hash)>;
+    // runs in the child on [first, first + count), returns false on failure
+    using RunShard = std::function<bool(size_t first, size_t count, Store const& store)>;
+
+    ProcessShards(size_t nbProcesses, size_t memoryLimitMb = 0, size_t retries = 1)
+        : _nbProcesses(nbProcesses ? nbProcesses : 1)
+        , _memoryLimitMb(memoryLimitMb)
+        , _retries(retries)
+    {}
+
+    ~ProcessShards()
+    {
+        unmap();
+    }
+
+    ProcessShards(ProcessShards const&) = delete;
+    ProcessShards& operator=(ProcessShards const&) = delete;
+
+    // '\r' percentage of the seeds done on std::cout while run waits (on)
+    void showProgress(bool show) { _showProgress = show; }
+
+    bool run(size_t first, size_t count, RunShard const& runShard, std::ostream& log)
+    {
+#ifdef __unix__
+        unmap();
+        _first = first;
+        if (count == 0)
+            return true;
+        size_t const nbShards = std::min(_nbProcesses, count);
+        _size = nbShards * sizeof(ShardProgress) + count * sizeof(uint64_t);
+        void* data = ::mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (data == MAP_FAILED)
+        {
+            log << "cannot map " << (_size >> 20) << " MB of shared memory" << std::endl;
+            return false;
+        }
+        _data = data;
+        _progress = static_cast<ShardProgress*>(data);
+        _hashes = reinterpret_cast<uint64_t*>(_progress + nbShards);
+        for (size_t s = 0; s < nbShards; ++s)
+            new (&_progress[s]) ShardProgress();
+
+        std::vector<Shard> shards(nbShards);
+        for (size_t s = 0; s < nbShards; ++s)
+        {
+            shards[s].first = count * s / nbShards;
+            shards[s].count = count * (s + 1) / nbShards - shards[s].first;
+            if (!start(shards[s], s, runShard, log))
+            {
+                stop(shards);
+                return false;
+            }
+        }
+
+        bool ok = true;
+        size_t running = nbShards;
+        size_t lastPercent = 0;
+        while (running > 0)
+        {
+            // only the shards' own children: a host process may have others
+            bool reaped = false;
+            for (size_t s = 0; s < nbShards; ++s)
+            {
+                if (shards[s].pid <= 0)
+                    continue;
+                int status = 0;
+                pid_t pid = poll(shards[s].pid, status);
+                if (pid == 0)
+                    continue;
+                if (pid < 0)
+                {
+                    log << "\rwaitpid failed on shard " << s << std::endl;
+                    stop(shards);
+                    unmap();
+                    return false;
+                }
+                reaped = true;
+                shards[s].pid = 0;
+
+                bool completed = WIFEXITED(status) && WEXITSTATUS(status) == 0
+                                 && _progress[s].done.load(std::memory_order_acquire) == shards[s].count;
+                if (completed)
+                {
+                    --running;
+                    continue;
+                }
+
+                log << "\rshard " << s << " (seeds " << first + shards[s].first << " to "
+                    << first + shards[s].first + shards[s].count - 1 << ") ";
+                if (WIFSIGNALED(status))
+                    log << "killed by signal " << WTERMSIG(status);
+                else
+                    log << "exited with " << WEXITSTATUS(status);
+                if (shards[s].attempts <= _retries && start(shards[s], s, runShard, log))
+                    log << ", restarted" << std::endl;
+                else
+                {
+                    log << ", giving up" << std::endl;
+                    ok = false;
+                    --running;
+                }
+            }
+            if (reaped)
+                continue;
+
+            size_t done = 0;
+            for (size_t s = 0; s < nbShards; ++s)
+                done += _progress[s].done.load(std::memory_order_relaxed);
+            size_t percent = done * 100 / count;
+            if (_showProgress && percent != lastPercent)
+            {
+                std::cout << '\r' << percent << "%" << std::flush;
+                lastPercent = percent;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        if (_showProgress)
+            std::cout << std::endl;
+        return ok;
+#else
+        (void)first;
+        (void)count;
+        (void)runShard;
+        log << "processes are only supported on POSIX systems" << std::endl;
+        return false;
+#endif
+    }
+
+    // Hash of seed, once run succeeded
+    uint64_t hash(size_t seed) const { return _hashes[seed - _first]; }
+
+private:
+    struct alignas(64) ShardProgress
+    {
+        std::atomic<uint64_t> done{0};
+    };
+
+    struct Shard
+    {
+        size_t first = 0;
+        size_t count = 0;
+#ifdef __unix__
+        pid_t pid = 0;
+#endif
+        size_t attempts = 0;
+    };
+
+#ifdef __unix__
+    // waitpid(pid, WNOHANG), again when a signal interrupts it: 0 while the
+    // child runs, pid once it is gone, -1 on error
+    static pid_t poll(pid_t pid, int& status)
+    {
+        pid_t result;
+        do
+            result = ::waitpid(pid, &status, WNOHANG);
+        while (result < 0 && errno == EINTR);
+        return result;
+    }
+
+    static void stop(std::vector<Shard>& shards)
+    {
+        for (auto& shard : shards)
+        {
+            if (shard.pid > 0)
+            {
+                ::kill(shard.pid, SIGKILL);
+                pid_t pid;
+                do
+                    pid = ::waitpid(shard.pid, nullptr, 0);
+                while (pid < 0 && errno == EINTR);
+                shard.pid = 0;
+            }
+        }
+    }
+
+    bool start(Shard& shard, size_t index, RunShard const& runShard, std::ostream& log)
+    {
+        _progress[index].done.store(0, std::memory_order_relaxed);
+        ++shard.attempts;
+        // nothing buffered may be written twice, by the parent and the child
+        std::cout.flush();
+        log.flush();
+
+        pid_t pid = ::fork();
+        if (pid < 0)
+        {
+            log << "fork failed" << std::endl;
+            return false;
+        }
+        if (pid > 0)
+        {
+            shard.pid = pid;
+            return true;
+        }
+
+        // child: quiet, limited, and gone without running the parent's destructors
+        std::cout.setstate(std::ios_base::failbit);
+        if (_memoryLimitMb)
+        {
+            struct rlimit limit;
+            limit.rlim_cur = limit.rlim_max = static_cast<rlim_t>(_memoryLimitMb) << 20;
+            ::setrlimit(RLIMIT_AS, &limit);
+        }
+        uint64_t* hashes = _hashes;
+        size_t const first = _first;
+        std::atomic<uint64_t>& done = _progress[index].done;
+        bool ok = runShard(_first + shard.first, shard.count, [hashes, first, &done](size_t seed, uint64_t hash)
+        {
+            hashes[seed - first] = hash;
+            done.fetch_add(1, std::memory_order_release);
+        });
+        std::_Exit(ok ? 0 : 1);
+    }
+#endif
+
+    void unmap()
+    {
+#ifdef __unix__
+        if (_data)
+            ::munmap(_data, _size);
+#endif
+        _data = nullptr;
+    }
+
+    size_t _nbProcesses;
+    size_t _memoryLimitMb;
+    size_t _retries;
+    bool _showProgress = true;
+    void* _data = nullptr;
+    size_t _size = 0;
+    ShardProgress* _progress = nullptr;
+    uint64_t* _hashes = nullptr;
+    size_t _first = 0;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <utility>
+
+// LSD radix sort on 32-bit keys in 3 passes of 11, 11 and 10 bits: 2048
+// buckets per pass keep the histograms and the write cursors in L1.
+// The three histograms are built by a single read of the input. A pass
+// whose digit is the same for every value is skipped: the buckets of an
+// MSD partition share their top bits and only take two passes.
+//
+// Sorts size values of data using scratch (as large), returns the one of
+// the two holding the sorted values.
+inline uint32_t* radixSortPasses(uint32_t* data, uint32_t* scratch, size_t size)
+{
+    static const unsigned nbBits = 11;
+    static const size_t nbBuckets = size_t(1) << nbBits;
+    static const uint32_t mask = nbBuckets - 1;
+    // distance, in elements, of the scatter destinations prefetched ahead
+    static const size_t prefetchDistance = 16;
+
+    if (size < 2)
+        return data;
+
+    uint32_t histograms[3][nbBuckets];
+    ::memset(histograms, 0, sizeof(histograms));
+    for (size_t i = 0; i < size; ++i)
+    {
+        uint32_t value = data[i];
+        ++histograms[0][value & mask];
+        ++histograms[1][(value >> nbBits) & mask];
+        ++histograms[2][value >> (2 * nbBits)];
+    }
+
+    uint32_t* src = data;
+    uint32_t* dst = scratch;
+    for (unsigned pass = 0; pass < 3; ++pass)
+    {
+        unsigned const shift = pass * nbBits;
+        uint32_t* offsets = histograms[pass];
+        if (offsets[(src[0] >> shift) & mask] == size)
+            continue;
+
+        // exclusive prefix sum: offsets become the first write position
+        uint32_t sum = 0;
+        for (size_t b = 0; b < nbBuckets; ++b)
+        {
+            uint32_t count = offsets[b];
+            offsets[b] = sum;
+            sum += count;
+        }
+
+        size_t i = 0;
+        for (; i + prefetchDistance < size; ++i)
+        {
+            uint32_t ahead = src[i + prefetchDistance];
+            __builtin_prefetch(dst + offsets[(ahead >> shift) & mask], 1);
+            uint32_t value = src[i];
+            dst[offsets[(value >> shift) & mask]++] = value;
+        }
+        for (; i < size; ++i)
+        {
+            uint32_t value = src[i];
+            dst[offsets[(value >> shift) & mask]++] = value;
+        }
+        std::swap(src, dst);
+    }
+    return src;
+}
+
+// scratch is resized to numbers.size() and swapped with numbers when it
+// ends up holding the sorted values, so a caller keeping one scratch per
+// thread never allocates in steady state.
+inline void radixSort(std::vector<uint32_t>& numbers, std::vector<uint32_t>& scratch)
+{
+    if (numbers.size() < 2)
+        return;
+    scratch.resize(numbers.size());
+    if (radixSortPasses(numbers.data(), scratch.data(), numbers.size()) != numbers.data())
+        numbers.swap(scratch);
+}
+
+// Sorts [first, last) in place, scratch holds at least last - first values
+inline void radixSort(uint32_t* first, uint32_t* last, uint32_t* scratch)
+{
+    size_t const size = static_cast<size_t>(last - first);
+    uint32_t* sorted = radixSortPasses(first, scratch, size);
+    if (sorted != first)
+        ::memcpy(first, sorted, size * sizeof(uint32_t));
+}
@@ -0,0 +1,557 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <vector>
+
+#include "thread_pool.hpp"
+#include "work_stealing.hpp"
+#include "radix_sort.hpp"
+#include "simd_sort.hpp"
+#include "buffer_pool.hpp"
+#include "simd_mt19937.hpp"
+#include "fused_sort.hpp"
+#include "hash_cache.hpp"
+#include "process_shards.hpp"
+#include "trace.hpp"
+#include "memory_budget.hpp"
+#include "worker_placement.hpp"
+
+// The seed job as a library: generate, sort and hash every seed of a range
+// on an executor, the hashes going to a caller's array or callback. Header
+// only, nothing printed, an executor can be kept and reused for batch after
+// batch by a long running process:
+//
+//     PoolExecutor executor(8);
+//     std::vector<uint64_t> hashes(1000);
+//     hashSeeds(SeedRange{0, 1000}, SeedOptions(), executor, hashes.data());
+//
+// The exercise's generateNumbers, sortNumbers and computeHash live here,
+// unchanged, so that main.cpp and other programs share them.
+
+inline std::vector<uint32_t> generateNumbers(size_t seed)
+{
+    std::mt19937 generator(seed);
+    std::vector<uint32_t> numbers;
+    size_t nb = (generator() % 1000000) + 100000;
+
+    numbers.reserve(nb);
+    for (size_t i = 0; i < nb; ++i)
+    {
+        numbers.emplace_back(generator());
+    }
+    return numbers;
+}
+
+inline void sortNumbers(std::vector<uint32_t>& numbers)
+{
+    std::sort(numbers.begin(), numbers.end());
+}
+
+inline uint64_t computeHash(std::vector<uint32_t> const& numbers)
+{
+    uint64_t hash = numbers.size();
+    for (auto& i : numbers)
+    {
+        hash ^= i + 0x9e3779b9f83da20c + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
+
+enum class SortEngine
+{
+    Std,
+    Radix,
+    // AVX2 quicksort and sorting networks, std::sort without AVX2
+    Simd,
+};
+
+enum class GeneratorEngine
+{
+    Std,
+    Simd,
+};
+
+// Steps merged together instead of run one after the other
+enum class Fusion
+{
+    None,
+    // generate straight into buckets of the top bits, sort each bucket
+    Buckets,
+    // as Buckets, and hash every bucket as soon as it is sorted
+    BucketsHash,
+};
+
+// How each seed is processed, whichever executor runs it
+struct SeedOptions
+{
+    // a seed draws (first output % sizeSpread) + minSize numbers
+    size_t minSize = 100000;
+    size_t sizeSpread = 1000000;
+    SortEngine sortEngine = SortEngine::Std;
+    GeneratorEngine generatorEngine = GeneratorEngine::Std;
+    Fusion fusion = Fusion::None;
+    unsigned bucketBits = 10;
+    // recycle the number buffers instead of allocating one per seed
+    BufferPool* bufferPool = nullptr;
+    // hashes of the seeds computed by earlier runs
+    HashCache* cache = nullptr;
+    // start and end of every stage of every seed
+    Tracer* tracer = nullptr;
+    // seeds wait for their predicted footprint to fit before they allocate
+    MemoryBudget* memoryBudget = nullptr;
+    // pinned workers with their own buffer arena, seeds counted per node
+    WorkerPlacement* placement = nullptr;
+
+    // sizes of generateNumbers
+    bool defaultSizes() const { return minSize == 100000 && sizeSpread == 1000000; }
+};
+
+// Where the number buffers of the calling thread come from: its own arena
+// under a placement, else the shared pool if any
+inline BufferPool* numbersPool(SeedOptions const& options)
+{
+    if (options.placement)
+    {
+        if (BufferPool* arena = options.placement->localArena())
+            return arena;
+    }
+    return options.bufferPool;
+}
+
+// Number of values of a seed, drawn from the first output of its generator
+template <typename Generator>
+size_t drawSize(Generator& generator, SeedOptions const& options)
+{
+    return (generator() % options.sizeSpread) + options.minSize;
+}
+
+// Identifies the workload in the hash cache: every engine and fusion gives
+// the same hashes, only the sizes change them. Both are mixed whole, so
+// sizes of 2^32 and more do not collide as a shift and xor would.
+inline uint64_t workloadKey(SeedOptions const& options)
+{
+    return mixBits(mixBits(options.minSize) ^ (options.sizeSpread + 0x9e3779b97f4a7c15));
+}
+
+// Without keepScratch, the radix sort frees its scratch array instead of
+// keeping it for the next seed of the thread
+inline void sortWith(SortEngine engine, std::vector<uint32_t>& numbers, bool keepScratch = true)
+{
+    if (engine == SortEngine::Radix)
+    {
+        thread_local std::vector<uint32_t> scratch;
+        radixSort(numbers, scratch);
+        if (!keepScratch)
+            scratch = std::vector<uint32_t>();
+    }
+    else if (engine == SortEngine::Simd)
+        simdSort(numbers);
+    else
+        sortNumbers(numbers);
+}
+
+// Sorts a bucket of the fusions in place with the --sort engine
+struct EngineBucketSort
+{
+    SortEngine engine;
+
+    void operator()(uint32_t* first, uint32_t* last) const
+    {
+        if (engine == SortEngine::Radix)
+        {
+            // a bucket is a few thousand values, its scratch is kept
+            thread_local std::vector<uint32_t> scratch;
+            if (scratch.size() < static_cast<size_t>(last - first))
+                scratch.resize(static_cast<size_t>(last - first));
+            radixSort(first, last, scratch.data());
+        }
+        else if (engine == SortEngine::Simd)
+            simdSort(first, last);
+        else
+            std::sort(first, last);
+    }
+};
+
+
+inline void reserveNumbers(std::vector<uint32_t>& numbers, size_t nb, BufferPool const* pool)
+{
+    if (pool)
+        pool->reserve(numbers, nb);
+    else
+        numbers.reserve(nb);
+}
+
+// Same numbers as generateNumbers, written in an existing buffer
+inline void generateNumbersInto(size_t seed, std::vector<uint32_t>& numbers, SeedOptions const& options)
+{
+    std::mt19937 generator(seed);
+    size_t nb = drawSize(generator, options);
+
+    numbers.clear();
+    reserveNumbers(numbers, nb, numbersPool(options));
+    for (size_t i = 0; i < nb; ++i)
+    {
+        numbers.emplace_back(generator());
+    }
+}
+
+// Same numbers again, from the vectorised MT19937 in blocks of 624
+inline void generateNumbersSimd(size_t seed, std::vector<uint32_t>& numbers, SeedOptions const& options)
+{
+    SimdMt19937 generator(static_cast<uint32_t>(seed));
+    size_t nb = drawSize(generator, options);
+
+    numbers.clear();
+    reserveNumbers(numbers, nb, numbersPool(options));
+    generator.append(numbers, nb);
+}
+
+inline std::vector<uint32_t> generateWith(size_t seed, SeedOptions const& options)
+{
+    BufferPool* pool = numbersPool(options);
+    if (!pool && options.generatorEngine == GeneratorEngine::Std && options.defaultSizes())
+        return generateNumbers(seed);
+
+    std::vector<uint32_t> numbers;
+    if (pool)
+        numbers = pool->acquire();
+    if (options.generatorEngine == GeneratorEngine::Simd)
+        generateNumbersSimd(seed, numbers, options);
+    else
+        generateNumbersInto(seed, numbers, options);
+    return numbers;
+}
+
+inline void releaseNumbers(std::vector<uint32_t>&& numbers, SeedOptions const& options)
+{
+    if (BufferPool* pool = numbersPool(options))
+        pool->release(std::move(numbers));
+    else
+        numbers = std::vector<uint32_t>();
+}
+
+// The values are scattered to their buckets in uninitialised scratch, so no
+// pass zero-fills an array first. With withHash, each bucket is hashed right
+// after its sort and the hash returned, numbers is left empty. Otherwise
+// each sorted bucket is appended to numbers while it is still in cache, and
+// 0 is returned.
+template <typename Generator>
+uint64_t generateBucketSortedNumbers(Generator generator, std::vector<uint32_t>& numbers,
+                                     SeedOptions const& options, bool withHash)
+{
+    thread_local UninitializedBuffer scratch;
+    size_t nb = drawSize(generator, options);
+
+    numbers.clear();
+    uint64_t result = 0;
+    if (withHash)
+    {
+        StreamHash hash(nb);
+        generateBucketSorted(generator, nb, options.bucketBits, scratch, EngineBucketSort{options.sortEngine},
+                             [&hash](uint32_t const* first, uint32_t const* last) { hash.update(first, last); });
+        result = hash.value();
+    }
+    else
+    {
+        reserveNumbers(numbers, nb, numbersPool(options));
+        generateBucketSorted(generator, nb, options.bucketBits, scratch, EngineBucketSort{options.sortEngine},
+                             [&numbers](uint32_t const* first, uint32_t const* last)
+                             { numbers.insert(numbers.end(), first, last); });
+    }
+    if (options.memoryBudget)
+        scratch.reset();
+    return result;
+}
+
+inline uint64_t generateBucketSortedWith(size_t seed, std::vector<uint32_t>& numbers, SeedOptions const& options, bool withHash)
+{
+    BufferPool* pool = numbersPool(options);
+    if (pool && !withHash)
+        numbers = pool->acquire();
+    if (options.generatorEngine == GeneratorEngine::Simd)
+        return generateBucketSortedNumbers(SimdMt19937(static_cast<uint32_t>(seed)), numbers, options, withHash);
+    return generateBucketSortedNumbers(std::mt19937(seed), numbers, options, withHash);
+}
+
+// Numbers of a seed, sorted, by whichever engines or fusion are selected
+inline std::vector<uint32_t> sortedNumbers(size_t seed, SeedOptions const& options)
+{
+    std::vector<uint32_t> numbers;
+    if (options.fusion == Fusion::Buckets || options.fusion == Fusion::BucketsHash)
+    {
+        TraceSpan span(options.tracer, TraceStage::Fused, seed);
+        generateBucketSortedWith(seed, numbers, options, false);
+        return numbers;
+    }
+
+    {
+        TraceSpan span(options.tracer, TraceStage::Generate, seed);
+        numbers = generateWith(seed, options);
+    }
+    TraceSpan span(options.tracer, TraceStage::Sort, seed);
+    sortWith(options.sortEngine, numbers, !options.memoryBudget);
+    return numbers;
+}
+
+// computeHash of the sorted numbers, generated in numbers; with the
+// buckets-hash fusion the sorted array is never read back as a whole
+inline uint64_t generateSortHash(size_t seed, std::vector<uint32_t>& numbers, SeedOptions const& options)
+{
+    if (options.fusion == Fusion::BucketsHash)
+    {
+        TraceSpan span(options.tracer, TraceStage::Fused, seed);
+        return generateBucketSortedWith(seed, numbers, options, true);
+    }
+
+    numbers = sortedNumbers(seed, options);
+    TraceSpan span(options.tracer, TraceStage::Hash, seed);
+    return computeHash(numbers);
+}
+
+// Same first draw as generateNumbers: the size of a seed costs one mt19937
+// seeding and one call, nothing is generated.
+inline size_t predictSize(size_t seed, SeedOptions const& options)
+{
+    std::mt19937 generator(seed);
+    return drawSize(generator, options);
+}
+
+// Bytes a seed holds while in flight: its numbers, and the scratch array of
+// the radix sort or the bucket blocks of the scatter. The buckets-hash
+// fusion only fills the bucket blocks.
+inline size_t predictFootprint(size_t seed, SeedOptions const& options)
+{
+    size_t const size = predictSize(seed, options);
+    if (options.fusion == Fusion::BucketsHash)
+        return bucketScratchSize(size, options.bucketBits) * sizeof(uint32_t);
+    if (options.fusion == Fusion::Buckets)
+        return (size + bucketScratchSize(size, options.bucketBits)) * sizeof(uint32_t);
+    if (options.sortEngine == SortEngine::Radix)
+        return 2 * size * sizeof(uint32_t);
+    return size * sizeof(uint32_t);
+}
+
+// Waits until seed fits in the memory budget, returns what it was admitted
+// with, to release once its numbers are gone (0 without a budget)
+inline size_t admitSeed(size_t seed, SeedOptions const& options)
+{
+    if (!options.memoryBudget)
+        return 0;
+    size_t footprint = predictFootprint(seed, options);
+    options.memoryBudget->acquire(footprint);
+    return footprint;
+}
+
+inline uint64_t processSeed(size_t seed, SeedOptions const& options)
+{
+    uint64_t hash = 0;
+    if (options.cache && options.cache->find(seed, workloadKey(options), hash))
+    {
+        if (options.placement)
+            options.placement->seedDone(0);
+        return hash;
+    }
+
+    size_t footprint = admitSeed(seed, options);
+    std::vector<uint32_t> numbers;
+    hash = generateSortHash(seed, numbers, options);
+    // the buckets-hash fusion leaves no numbers behind
+    if (options.placement)
+        options.placement->seedDone(options.fusion == Fusion::BucketsHash ? predictSize(seed, options) : numbers.size());
+    releaseNumbers(std::move(numbers), options);
+    if (footprint)
+        options.memoryBudget->release(footprint);
+    if (options.cache)
+        options.cache->insert(seed, workloadKey(options), hash);
+    return hash;
+}
+
+// Receives the hash of every seed, from any worker, in any order: the
+// output order does not depend on the completion order.
+using HashSink = std::function<void(size_t seed, uint64_t hash)>;
+
+// Seeds first to first + count - 1
+struct SeedRange
+{
+    size_t first = 0;
+    size_t count = 0;
+};
+
+// Where the seeds of a range run. run calls store(seed, hashSeed(seed))
+// once for every seed of the range, from any of its threads, and returns
+// once they are all stored; false when the range could not be run. One run
+// at a time per executor.
+class SeedExecutor
+{
+public:
+    using HashSeed = std::function<uint64_t(size_t seed)>;
+
+    virtual ~SeedExecutor() = default;
+
+    virtual bool run(SeedRange range, HashSeed const& hashSeed, HashSink const& store) = 0;
+};
+
+// The calling thread, in seed order
+class InlineExecutor : public SeedExecutor
+{
+public:
+    bool run(SeedRange range, HashSeed const& hashSeed, HashSink const& store) override
+    {
+        for (size_t seed = range.first; seed < range.first + range.count; ++seed)
+            store(seed, hashSeed(seed));
+        return true;
+    }
+};
+
+// A shared FIFO of seeds, on threads started once for the executor's life
+class PoolExecutor : public SeedExecutor
+{
+public:
+    explicit PoolExecutor(size_t nbThreads, ThreadPool::WorkerStart onStart = ThreadPool::WorkerStart())
+        : _pool(nbThreads, std::move(onStart))
+    {}
+
+    bool run(SeedRange range, HashSeed const& hashSeed, HashSink const& store) override
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (size_t seed = range.first; seed < range.first + range.count; ++seed)
+        {
+            _pool.waitPending(4 * _pool.size());
+            _pool.submit([&hashSeed, &store, seed] { store(seed, hashSeed(seed)); });
+        }
+        _pool.wait();
+        return true;
+    }
+
+private:
+    ThreadPool _pool;
+    std::mutex _mutex;
+};
+
+// Per-worker deques of seed ranges with work stealing. With a step, the
+// seeds of a range are handed out step at a time (WorkStealingScheduler).
+class StealingExecutor : public SeedExecutor
+{
+public:
+    explicit StealingExecutor(size_t nbThreads, size_t step = 0,
+                              WorkStealingScheduler::WorkerStart onStart = WorkStealingScheduler::WorkerStart())
+        : _scheduler(nbThreads, std::move(onStart))
+        , _step(step)
+    {}
+
+    bool run(SeedRange range, HashSeed const& hashSeed, HashSink const& store) override
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _scheduler.run(range.count, [&hashSeed, &store, range](size_t i)
+        {
+            size_t seed = range.first + i;
+            store(seed, hashSeed(seed));
+        }, _step);
+        return true;
+    }
+
+    // busy and idle time, tasks and steals of each worker over every run
+    void writeStats(std::ostream& stream) const
+    {
+        _scheduler.writeStats(stream);
+    }
+
+private:
+    WorkStealingScheduler _scheduler;
+    size_t _step;
+    std::mutex _mutex;
+};
+
+// Contiguous shards of the range in forked processes (POSIX only), each
+// running a work stealing executor of threadsPerProcess threads or the
+// caller's runShard. The hashes are stored in seed order by the calling
+// thread once every shard is done; a crashed shard is run again once.
+//
+// For command line tools only: every run forks its processes anew, and
+// only the forking thread exists in the children, so the process calling
+// run must be single threaded. A multithreaded service keeps a
+// PoolExecutor or a StealingExecutor instead.
+class ProcessExecutor : public SeedExecutor
+{
+public:
+    // runs one shard in a child process, its hashes going to store
+    using RunShard = std::function<bool(SeedRange shard, HashSeed const& hashSeed, HashSink const& store)>;
+
+    ProcessExecutor(size_t nbProcesses, size_t threadsPerProcess = 1, size_t memoryLimitMb = 0,
+                    std::ostream& log = std::cerr)
+        : ProcessExecutor(nbProcesses, stealingShard(threadsPerProcess), memoryLimitMb, log)
+    {}
+
+    ProcessExecutor(size_t nbProcesses, RunShard runShard, size_t memoryLimitMb = 0, std::ostream& log = std::cerr)
+        : _nbProcesses(nbProcesses)
+        , _runShard(std::move(runShard))
+        , _memoryLimitMb(memoryLimitMb)
+        , _log(log)
+    {}
+
+    // '\r' percentage of the seeds done on std::cout while run waits (off)
+    void showProgress(bool show) { _showProgress = show; }
+
+    bool run(SeedRange range, HashSeed const& hashSeed, HashSink const& store) override
+    {
+        ProcessShards shards(_nbProcesses, _memoryLimitMb);
+        shards.showProgress(_showProgress);
+        RunShard const& runShard = _runShard;
+        bool ok = shards.run(range.first, range.count,
+                             [&hashSeed, &runShard](size_t first, size_t count, ProcessShards::Store const& shardStore)
+        {
+            return runShard(SeedRange{first, count}, hashSeed, shardStore);
+        }, _log);
+        if (!ok)
+            return false;
+        for (size_t seed = range.first; seed < range.first + range.count; ++seed)
+            store(seed, shards.hash(seed));
+        return true;
+    }
+
+private:
+    static RunShard stealingShard(size_t threads)
+    {
+        return [threads](SeedRange shard, HashSeed const& hashSeed, HashSink const& store)
+        {
+            StealingExecutor executor(threads);
+            return executor.run(shard, hashSeed, store);
+        };
+    }
+
+    size_t _nbProcesses;
+    RunShard _runShard;
+    size_t _memoryLimitMb;
+    std::ostream& _log;
+    bool _showProgress = false;
+};
+
+// Seeds are 32-bit for the generators
+inline bool validSeedRange(SeedRange range)
+{
+    return range.first + range.count <= (uint64_t(1) << 32);
+}
+
+// Calls sink(seed, hash) for every seed of range, processed with options
+inline bool hashSeeds(SeedRange range, SeedOptions const& options, SeedExecutor& executor, HashSink const& sink)
+{
+    if (!validSeedRange(range))
+        return false;
+    return executor.run(range, [&options](size_t seed) { return processSeed(seed, options); }, sink);
+}
+
+// hashes[i] = hash of seed range.first + i, for range.count hashes
+inline bool hashSeeds(SeedRange range, SeedOptions const& options, SeedExecutor& executor, uint64_t* hashes)
+{
+    size_t const first = range.first;
+    return hashSeeds(range, options, executor, [hashes, first](size_t seed, uint64_t hash)
+    {
+        hashes[seed - first] = hash;
+    });
+}
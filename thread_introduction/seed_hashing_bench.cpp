@@ -0,0 +1,78 @@
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <string>
+#include <memory>
+
+#include "seed_hashing.hpp"
+
+// hashSeeds on every executor, the way a service embeds it: each executor
+// is built once and then hashes several consecutive batches of seeds.
+// Every hash is checked against the inline executor's.
+//
+// Usage: seed_hashing_bench [seeds per batch] [batches] [threads] [processes]
+int main(int argc, char** argv)
+{
+    using Clock = std::chrono::steady_clock;
+
+    size_t nbSeeds = argc > 1 ? std::stoul(argv[1]) : 100;
+    size_t nbBatches = argc > 2 ? std::stoul(argv[2]) : 3;
+    size_t nbThreads = argc > 3 ? std::stoul(argv[3]) : std::thread::hardware_concurrency();
+    size_t nbProcesses = argc > 4 ? std::stoul(argv[4]) : 2;
+    if (nbThreads == 0)
+        nbThreads = 1;
+
+    SeedOptions options;
+    options.sortEngine = SortEngine::Radix;
+    options.generatorEngine = GeneratorEngine::Simd;
+    SeedRange const all{0, nbSeeds * nbBatches};
+
+    std::vector<uint64_t> expected(all.count);
+    std::vector<uint64_t> hashes(all.count);
+    // one executor alive at a time: the process executor forks, the
+    // threads of a pool would not follow
+    auto makeExecutor = [nbThreads, nbProcesses](std::string const& name) -> std::unique_ptr<SeedExecutor>
+    {
+        if (name == "pool")
+            return std::unique_ptr<SeedExecutor>(new PoolExecutor(nbThreads));
+        if (name == "steal")
+            return std::unique_ptr<SeedExecutor>(new StealingExecutor(nbThreads));
+        if (name == "processes")
+            return std::unique_ptr<SeedExecutor>(new ProcessExecutor(nbProcesses, nbThreads));
+        return std::unique_ptr<SeedExecutor>(new InlineExecutor());
+    };
+
+    std::cout << nbBatches << " batches of " << nbSeeds << " seeds, " << nbThreads << " threads, "
+              << nbProcesses << " processes" << std::endl;
+    std::cout << std::setw(12) << "executor" << std::setw(12) << "seeds/s" << std::setw(12) << "speedup" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    double inlineSeconds = 0.;
+    for (std::string name : {"inline", "pool", "steal", "processes"})
+    {
+        std::unique_ptr<SeedExecutor> executor = makeExecutor(name);
+        uint64_t* out = name == "inline" ? expected.data() : hashes.data();
+        auto start = Clock::now();
+        for (size_t b = 0; b < nbBatches; ++b)
+        {
+            SeedRange batch{b * nbSeeds, nbSeeds};
+            if (!hashSeeds(batch, options, *executor, out + batch.first))
+            {
+                std::cerr << name << ": batch " << b << " failed" << std::endl;
+                return 2;
+            }
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (out != expected.data() && hashes != expected)
+        {
+            std::cerr << name << ": hashes differ from the inline executor" << std::endl;
+            return 2;
+        }
+        if (out == expected.data())
+            inlineSeconds = seconds;
+        std::cout << std::setw(12) << name << std::setw(12) << all.count / seconds
+                  << std::setw(11) << inlineSeconds / seconds << "x" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// MT19937 producing exactly the std::mt19937 sequence for the same seed,
+// with the state regeneration (twist) and the tempering done on SIMD lanes:
+// 8 words at a time with AVX2, 4 with SSE2, one otherwise.
+// A whole state is tempered at once into a block of 624 outputs, operator()
+// and fill() then only copy from that block.
+class SimdMt19937
+{
+public:
+    using result_type = uint32_t;
+
+    static const size_t n = 624;
+    static const size_t m = 397;
+
+    explicit SimdMt19937(uint32_t seed = 5489u)
+    {
+        this->seed(seed);
+    }
+
+    void seed(uint32_t value)
+    {
+        _state[0] = value;
+        for (uint32_t i = 1; i < n; ++i)
+            _state[i] = 1812433253u * (_state[i - 1] ^ (_state[i - 1] >> 30)) + i;
+        _index = n;
+    }
+
+    static constexpr uint32_t min() { return 0; }
+    static constexpr uint32_t max() { return 0xffffffffu; }
+
+    uint32_t operator()()
+    {
+        if (_index == n)
+            refill();
+        return _block[_index++];
+    }
+
+    void fill(uint32_t* out, size_t count)
+    {
+        while (count > 0)
+        {
+            if (_index == n)
+                refill();
+            size_t chunk = std::min(count, n - _index);
+            ::memcpy(out, _block + _index, chunk * sizeof(uint32_t));
+            _index += chunk;
+            out += chunk;
+            count -= chunk;
+        }
+    }
+
+    // Append count outputs to a vector-like container, without the
+    // value-initialisation a resize would do
+    template <typename Container>
+    void append(Container& out, size_t count)
+    {
+        while (count > 0)
+        {
+            if (_index == n)
+                refill();
+            size_t chunk = std::min(count, n - _index);
+            out.insert(out.end(), _block + _index, _block + _index + chunk);
+            _index += chunk;
+            count -= chunk;
+        }
+    }
+
+private:
+    static const uint32_t matrixA = 0x9908b0dfu;
+    static const uint32_t upperMask = 0x80000000u;
+    static const uint32_t lowerMask = 0x7fffffffu;
+
+    static uint32_t twistWord(uint32_t current, uint32_t next, uint32_t far)
+    {
+        uint32_t y = (current & upperMask) | (next & lowerMask);
+        return far ^ (y >> 1) ^ ((0u - (y & 1u)) & matrixA);
+    }
+
+    static uint32_t temper(uint32_t y)
+    {
+        y ^= y >> 11;
+        y ^= (y << 7) & 0x9d2c5680u;
+        y ^= (y << 15) & 0xefc60000u;
+        y ^= y >> 18;
+        return y;
+    }
+
+#if defined(__AVX2__)
+    static const size_t lanes = 8;
+
+    static void twistLanes(uint32_t* state, size_t i, size_t far)
+    {
+        __m256i const current = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(state + i));
+        __m256i const next = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(state + i + 1));
+        __m256i const farWords = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(state + far));
+        __m256i const y = _mm256_or_si256(_mm256_and_si256(current, _mm256_set1_epi32(int(upperMask))),
+                                          _mm256_and_si256(next, _mm256_set1_epi32(int(lowerMask))));
+        __m256i const odd = _mm256_sub_epi32(_mm256_setzero_si256(), _mm256_and_si256(y, _mm256_set1_epi32(1)));
+        __m256i const result = _mm256_xor_si256(_mm256_xor_si256(farWords, _mm256_srli_epi32(y, 1)),
+                                                _mm256_and_si256(odd, _mm256_set1_epi32(int(matrixA))));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(state + i), result);
+    }
+
+    static void temperLanes(uint32_t const* in, uint32_t* out)
+    {
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(in));
+        y = _mm256_xor_si256(y, _mm256_srli_epi32(y, 11));
+        y = _mm256_xor_si256(y, _mm256_and_si256(_mm256_slli_epi32(y, 7), _mm256_set1_epi32(int(0x9d2c5680u))));
+        y = _mm256_xor_si256(y, _mm256_and_si256(_mm256_slli_epi32(y, 15), _mm256_set1_epi32(int(0xefc60000u))));
+        y = _mm256_xor_si256(y, _mm256_srli_epi32(y, 18));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), y);
+    }
+#elif defined(__SSE2__)
+    static const size_t lanes = 4;
+
+    static void twistLanes(uint32_t* state, size_t i, size_t far)
+    {
+        __m128i const current = _mm_loadu_si128(reinterpret_cast<__m128i const*>(state + i));
+        __m128i const next = _mm_loadu_si128(reinterpret_cast<__m128i const*>(state + i + 1));
+        __m128i const farWords = _mm_loadu_si128(reinterpret_cast<__m128i const*>(state + far));
+        __m128i const y = _mm_or_si128(_mm_and_si128(current, _mm_set1_epi32(int(upperMask))),
+                                       _mm_and_si128(next, _mm_set1_epi32(int(lowerMask))));
+        __m128i const odd = _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(y, _mm_set1_epi32(1)));
+        __m128i const result = _mm_xor_si128(_mm_xor_si128(farWords, _mm_srli_epi32(y, 1)),
+                                             _mm_and_si128(odd, _mm_set1_epi32(int(matrixA))));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(state + i), result);
+    }
+
+    static void temperLanes(uint32_t const* in, uint32_t* out)
+    {
+        __m128i y = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in));
+        y = _mm_xor_si128(y, _mm_srli_epi32(y, 11));
+        y = _mm_xor_si128(y, _mm_and_si128(_mm_slli_epi32(y, 7), _mm_set1_epi32(int(0x9d2c5680u))));
+        y = _mm_xor_si128(y, _mm_and_si128(_mm_slli_epi32(y, 15), _mm_set1_epi32(int(0xefc60000u))));
+        y = _mm_xor_si128(y, _mm_srli_epi32(y, 18));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), y);
+    }
+#else
+    static const size_t lanes = 1;
+
+    static void twistLanes(uint32_t* state, size_t i, size_t far)
+    {
+        state[i] = twistWord(state[i], state[i + 1], state[far]);
+    }
+
+    static void temperLanes(uint32_t const* in, uint32_t* out)
+    {
+        *out = temper(*in);
+    }
+#endif
+
+    // Word i needs the old words i + 1 and i + m (mod n). Up to n - m, the
+    // far word is still old. Past it, the far word i + m - n was rewritten
+    // at least n - m words before, well outside a vector, so the in-order
+    // vector loop stays exact; only the last word, which wraps to word 0,
+    // is done alone.
+    void refill()
+    {
+        static const size_t split = n - m;
+        static const size_t firstVectorEnd = split / lanes * lanes;
+        static const size_t secondVectorEnd = split + (n - 1 - split) / lanes * lanes;
+
+        for (size_t i = 0; i < firstVectorEnd; i += lanes)
+            twistLanes(_state, i, i + m);
+        for (size_t i = firstVectorEnd; i < split; ++i)
+            _state[i] = twistWord(_state[i], _state[i + 1], _state[i + m]);
+        for (size_t i = split; i < secondVectorEnd; i += lanes)
+            twistLanes(_state, i, i - split);
+        for (size_t i = secondVectorEnd; i < n - 1; ++i)
+            _state[i] = twistWord(_state[i], _state[i + 1], _state[i - split]);
+        _state[n - 1] = twistWord(_state[n - 1], _state[0], _state[m - 1]);
+
+        size_t j = 0;
+        for (; j + lanes <= n; j += lanes)
+            temperLanes(_state + j, _block + j);
+        for (; j < n; ++j)
+            _block[j] = temper(_state[j]);
+        _index = 0;
+    }
+
+    uint32_t _state[n];
+    uint32_t _block[n];
+    size_t _index;
+};
@@ -0,0 +1,329 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_SORT_X86 1
+#include <immintrin.h>
+#define SIMD_SORT_AVX2 __attribute__((target("avx2")))
+#else
+#define SIMD_SORT_X86 0
+#endif
+
+// Quicksort of uint32_t on AVX2 registers: every partition step compares 8
+// values to the pivot at once and compacts them to both ends of the range
+// with one permutation from a 256-entry table; ranges of at most 64 values
+// are padded to 8 registers and sorted by a bitonic network (column sorting
+// network, 8x8 transpose, then bitonic merges of the sorted rows). Depth is
+// bounded like an introsort, by falling back to std::sort.
+//
+// The AVX2 code is compiled with a target attribute and chosen at runtime
+// from the CPU features, so a binary built without -mavx2 still uses it when
+// it can; elsewhere, simdSort is std::sort.
+namespace simd_sort
+{
+#if SIMD_SORT_X86
+    // values at most this many go through the sorting network
+    static const size_t networkSize = 64;
+
+    // For every 8-bit mask of the lanes <= pivot, the lane order that puts
+    // those lanes first and the others after, as 8 indices of 4 bits.
+    struct PartitionTable
+    {
+        uint32_t order[256];
+
+        constexpr PartitionTable()
+            : order()
+        {
+            for (uint32_t mask = 0; mask < 256; ++mask)
+            {
+                uint32_t packed = 0;
+                uint32_t position = 0;
+                for (uint32_t lane = 0; lane < 8; ++lane)
+                {
+                    if (mask & (1u << lane))
+                        packed |= lane << (4 * position++);
+                }
+                for (uint32_t lane = 0; lane < 8; ++lane)
+                {
+                    if (!(mask & (1u << lane)))
+                        packed |= lane << (4 * position++);
+                }
+                order[mask] = packed;
+            }
+        }
+    };
+
+    static constexpr PartitionTable partitionTable{};
+
+    SIMD_SORT_AVX2 inline void minMax(__m256i& a, __m256i& b)
+    {
+        __m256i const low = _mm256_min_epu32(a, b);
+        b = _mm256_max_epu32(a, b);
+        a = low;
+    }
+
+    SIMD_SORT_AVX2 inline __m256i reverse(__m256i v)
+    {
+        return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+    }
+
+    // Sorts a bitonic register: compare-exchange at distances 4, 2 then 1
+    SIMD_SORT_AVX2 inline __m256i cleanRegister(__m256i v)
+    {
+        __m256i other = _mm256_permute2x128_si256(v, v, 0x01);
+        v = _mm256_blend_epi32(_mm256_min_epu32(v, other), _mm256_max_epu32(v, other), 0xF0);
+        other = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+        v = _mm256_blend_epi32(_mm256_min_epu32(v, other), _mm256_max_epu32(v, other), 0xCC);
+        other = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+        return _mm256_blend_epi32(_mm256_min_epu32(v, other), _mm256_max_epu32(v, other), 0xAA);
+    }
+
+    // Sorts the bitonic sequence held by Count registers
+    template <size_t Count>
+    SIMD_SORT_AVX2 inline void cleanBitonic(__m256i* v)
+    {
+        for (size_t distance = Count / 2; distance > 0; distance /= 2)
+        {
+            for (size_t i = 0; i < Count; ++i)
+            {
+                if (!(i & distance))
+                    minMax(v[i], v[i + distance]);
+            }
+        }
+        for (size_t i = 0; i < Count; ++i)
+            v[i] = cleanRegister(v[i]);
+    }
+
+    // Merges the sorted runs v[0, Count) and v[Count, 2 Count) into one
+    template <size_t Count>
+    SIMD_SORT_AVX2 inline void mergeRuns(__m256i* v)
+    {
+        __m256i reversed[Count];
+        for (size_t i = 0; i < Count; ++i)
+            reversed[i] = reverse(v[2 * Count - 1 - i]);
+        for (size_t i = 0; i < Count; ++i)
+            minMax(v[i], reversed[i]);
+        for (size_t i = 0; i < Count; ++i)
+            v[Count + i] = reversed[i];
+        cleanBitonic<Count>(v);
+        cleanBitonic<Count>(v + Count);
+    }
+
+    SIMD_SORT_AVX2 inline void transpose(__m256i* v)
+    {
+        __m256i const t0 = _mm256_unpacklo_epi32(v[0], v[1]);
+        __m256i const t1 = _mm256_unpackhi_epi32(v[0], v[1]);
+        __m256i const t2 = _mm256_unpacklo_epi32(v[2], v[3]);
+        __m256i const t3 = _mm256_unpackhi_epi32(v[2], v[3]);
+        __m256i const t4 = _mm256_unpacklo_epi32(v[4], v[5]);
+        __m256i const t5 = _mm256_unpackhi_epi32(v[4], v[5]);
+        __m256i const t6 = _mm256_unpacklo_epi32(v[6], v[7]);
+        __m256i const t7 = _mm256_unpackhi_epi32(v[6], v[7]);
+        __m256i const u0 = _mm256_unpacklo_epi64(t0, t2);
+        __m256i const u1 = _mm256_unpackhi_epi64(t0, t2);
+        __m256i const u2 = _mm256_unpacklo_epi64(t1, t3);
+        __m256i const u3 = _mm256_unpackhi_epi64(t1, t3);
+        __m256i const u4 = _mm256_unpacklo_epi64(t4, t6);
+        __m256i const u5 = _mm256_unpackhi_epi64(t4, t6);
+        __m256i const u6 = _mm256_unpacklo_epi64(t5, t7);
+        __m256i const u7 = _mm256_unpackhi_epi64(t5, t7);
+        v[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+        v[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+        v[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+        v[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+        v[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+        v[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+        v[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+        v[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+    }
+
+    // Sorts at most networkSize values, padded with the largest value
+    SIMD_SORT_AVX2 inline void sortNetwork(uint32_t* first, size_t size)
+    {
+        alignas(32) uint32_t values[networkSize];
+        std::memcpy(values, first, size * sizeof(uint32_t));
+        std::fill(values + size, values + networkSize, UINT32_MAX);
+
+        __m256i v[8];
+        for (size_t i = 0; i < 8; ++i)
+            v[i] = _mm256_load_si256(reinterpret_cast<__m256i const*>(values + 8 * i));
+
+        // optimal 19 comparator network on the 8 registers: sorted columns
+        minMax(v[0], v[2]); minMax(v[1], v[3]); minMax(v[4], v[6]); minMax(v[5], v[7]);
+        minMax(v[0], v[4]); minMax(v[1], v[5]); minMax(v[2], v[6]); minMax(v[3], v[7]);
+        minMax(v[0], v[1]); minMax(v[2], v[3]); minMax(v[4], v[5]); minMax(v[6], v[7]);
+        minMax(v[2], v[4]); minMax(v[3], v[5]);
+        minMax(v[1], v[4]); minMax(v[3], v[6]);
+        minMax(v[1], v[2]); minMax(v[3], v[4]); minMax(v[5], v[6]);
+        // the columns become 8 sorted rows, merged two by two
+        transpose(v);
+        mergeRuns<1>(v);
+        mergeRuns<1>(v + 2);
+        mergeRuns<1>(v + 4);
+        mergeRuns<1>(v + 6);
+        mergeRuns<2>(v);
+        mergeRuns<2>(v + 4);
+        mergeRuns<4>(v);
+
+        for (size_t i = 0; i < 8; ++i)
+            _mm256_store_si256(reinterpret_cast<__m256i*>(values + 8 * i), v[i]);
+        std::memcpy(first, values, size * sizeof(uint32_t));
+    }
+
+    // Writes the lanes of v <= pivot at left and the others just below right
+    // (both write 8 values, the caller guarantees the room)
+    SIMD_SORT_AVX2 inline void partitionRegister(__m256i v, __m256i pivot, uint32_t*& left, uint32_t*& right)
+    {
+        __m256i const lowerOrEqual = _mm256_cmpeq_epi32(_mm256_max_epu32(v, pivot), pivot);
+        unsigned const mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(lowerOrEqual)));
+        __m256i const order = _mm256_and_si256(
+            _mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(partitionTable.order[mask])),
+                              _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28)),
+            _mm256_set1_epi32(7));
+        __m256i const packed = _mm256_permutevar8x32_epi32(v, order);
+        size_t const nbLeft = static_cast<size_t>(__builtin_popcount(mask));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(left), packed);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(right - 8), packed);
+        left += nbLeft;
+        right -= 8 - nbLeft;
+    }
+
+    // Moves the values <= pivot before the others, returns where they end.
+    // In place: the first and last registers are set aside, which leaves 16
+    // free slots; the next register is always read from the side with the
+    // least room, so both sides have room for a full register write.
+    SIMD_SORT_AVX2 inline uint32_t* partition(uint32_t* first, uint32_t* last, uint32_t pivotValue)
+    {
+        __m256i const pivot = _mm256_set1_epi32(static_cast<int>(pivotValue));
+        __m256i const firstRegister = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(first));
+        __m256i const lastRegister = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(last - 8));
+
+        uint32_t* readLeft = first + 8;
+        uint32_t* readRight = last - 8;
+        uint32_t* left = first;
+        uint32_t* right = last;
+        while (readRight - readLeft >= 8)
+        {
+            __m256i v;
+            if (readLeft - left <= right - readRight)
+            {
+                v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(readLeft));
+                readLeft += 8;
+            }
+            else
+            {
+                readRight -= 8;
+                v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(readRight));
+            }
+            partitionRegister(v, pivot, left, right);
+        }
+
+        // the last unread values and the two registers set aside, one by one
+        uint32_t rest[24];
+        size_t const nbRest = static_cast<size_t>(readRight - readLeft);
+        std::memcpy(rest, readLeft, nbRest * sizeof(uint32_t));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(rest + nbRest), firstRegister);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(rest + nbRest + 8), lastRegister);
+        for (size_t i = 0; i < nbRest + 16; ++i)
+        {
+            if (rest[i] <= pivotValue)
+                *left++ = rest[i];
+            else
+                *--right = rest[i];
+        }
+        return left;
+    }
+
+    inline uint32_t median(uint32_t a, uint32_t b, uint32_t c)
+    {
+        return std::max(std::min(a, b), std::min(std::max(a, b), c));
+    }
+
+    inline uint32_t choosePivot(uint32_t const* first, size_t size)
+    {
+        if (size < 1024)
+            return median(first[size / 4], first[size / 2], first[3 * size / 4]);
+        size_t const step = size / 8;
+        return median(median(first[step], first[2 * step], first[3 * step]),
+                      median(first[3 * step + step / 2], first[4 * step], first[4 * step + step / 2]),
+                      median(first[5 * step], first[6 * step], first[7 * step]));
+    }
+
+    SIMD_SORT_AVX2 inline void quicksort(uint32_t* first, uint32_t* last, size_t depth)
+    {
+        while (static_cast<size_t>(last - first) > networkSize)
+        {
+            if (depth-- == 0)
+            {
+                std::sort(first, last);
+                return;
+            }
+            uint32_t const pivot = choosePivot(first, static_cast<size_t>(last - first));
+            uint32_t* middle = partition(first, last, pivot);
+            if (middle == last)
+            {
+                // the pivot is the largest value: split the values equal to
+                // it off, they are already in place
+                if (pivot == 0)
+                    return;
+                last = partition(first, last, pivot - 1);
+                continue;
+            }
+            // recurse on the smaller side, loop on the larger one
+            if (middle - first < last - middle)
+            {
+                quicksort(first, middle, depth);
+                first = middle;
+            }
+            else
+            {
+                quicksort(middle, last, depth);
+                last = middle;
+            }
+        }
+        if (last - first > 1)
+            sortNetwork(first, static_cast<size_t>(last - first));
+    }
+
+    SIMD_SORT_AVX2 inline void sortAvx2(uint32_t* first, uint32_t* last)
+    {
+        size_t depth = 0;
+        for (size_t size = static_cast<size_t>(last - first); size > 1; size /= 2)
+            depth += 2;
+        quicksort(first, last, depth);
+    }
+#endif
+
+    inline bool avx2Supported()
+    {
+#if SIMD_SORT_X86
+        static bool const supported = __builtin_cpu_supports("avx2");
+        return supported;
+#else
+        return false;
+#endif
+    }
+}
+
+// Sorts [first, last) with AVX2 when the CPU has it, std::sort otherwise
+inline void simdSort(uint32_t* first, uint32_t* last)
+{
+#if SIMD_SORT_X86
+    if (simd_sort::avx2Supported())
+    {
+        simd_sort::sortAvx2(first, last);
+        return;
+    }
+#endif
+    std::sort(first, last);
+}
+
+inline void simdSort(std::vector<uint32_t>& numbers)
+{
+    simdSort(numbers.data(), numbers.data() + numbers.size());
+}
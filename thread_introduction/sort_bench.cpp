@@ -0,0 +1,77 @@
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <string>
+#include <algorithm>
+
+#include "radix_sort.hpp"
+#include "simd_sort.hpp"
+
+// Sort throughput of std::sort, the LSD radix sort and simdSort on random
+// uint32_t arrays from 16 values to maxSize, every result checked against
+// std::sort. Each size is sorted about repetitions x maxSize values in total.
+//
+// Usage: sort_bench [maxSize] [repetitions]
+int main(int argc, char** argv)
+{
+    using Clock = std::chrono::steady_clock;
+
+    size_t maxSize = argc > 1 ? std::stoul(argv[1]) : size_t(1) << 22;
+    size_t nbRepetitions = argc > 2 ? std::stoul(argv[2]) : 4;
+    std::mt19937 generator(0);
+
+    std::cout << "simdSort: " << (simd_sort::avx2Supported() ? "AVX2" : "std::sort fallback") << std::endl;
+    std::cout << std::setw(10) << "size" << std::setw(12) << "std" << std::setw(12) << "radix"
+              << std::setw(12) << "simd" << std::setw(12) << "vs std" << std::setw(12) << "vs radix"
+              << "   (ns/value)" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+
+    std::vector<uint32_t> scratch;
+    for (size_t size = 16; size <= maxSize; size *= 4)
+    {
+        // enough arrays of this size to sort as many values as the largest
+        size_t nbArrays = std::max<size_t>(1, maxSize / size) * nbRepetitions;
+        std::vector<uint32_t> input(size);
+        std::vector<uint32_t> expected;
+        std::vector<uint32_t> numbers;
+        double seconds[3] = {0., 0., 0.};
+
+        for (size_t a = 0; a < nbArrays; ++a)
+        {
+            for (auto& value : input)
+                value = generator();
+            for (size_t engine = 0; engine < 3; ++engine)
+            {
+                numbers = input;
+                auto start = Clock::now();
+                if (engine == 0)
+                    std::sort(numbers.begin(), numbers.end());
+                else if (engine == 1)
+                    radixSort(numbers, scratch);
+                else
+                    simdSort(numbers);
+                seconds[engine] += std::chrono::duration<double>(Clock::now() - start).count();
+
+                if (engine == 0)
+                    expected = numbers;
+                else if (numbers != expected)
+                {
+                    std::cerr << (engine == 1 ? "radixSort" : "simdSort") << " differs from std::sort on "
+                              << size << " values" << std::endl;
+                    return 2;
+                }
+            }
+        }
+
+        double values = static_cast<double>(nbArrays * size);
+        std::cout << std::setw(10) << size;
+        for (double s : seconds)
+            std::cout << std::setw(12) << s / values * 1e9;
+        std::cout << std::setw(11) << seconds[0] / seconds[2] << "x"
+                  << std::setw(11) << seconds[1] / seconds[2] << "x" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Fixed size pool of workers consuming a shared FIFO of tasks.
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+    // called on each worker thread with its index, before any task
+    using WorkerStart = std::function<void(size_t worker)>;
+
+    explicit ThreadPool(size_t nbThreads, WorkerStart onStart = WorkerStart())
+        : _onStart(std::move(onStart))
+    {
+        if (nbThreads == 0)
+            nbThreads = 1;
+        _workers.reserve(nbThreads);
+        for (size_t i = 0; i < nbThreads; ++i)
+            _workers.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _taskAvailable.notify_all();
+        for (auto& worker : _workers)
+            worker.join();
+    }
+
+    size_t size() const { return _workers.size(); }
+
+    void submit(Task task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _tasks.push_back(std::move(task));
+            ++_pending;
+        }
+        _taskAvailable.notify_one();
+    }
+
+    // Block until every submitted task has finished.
+    void wait()
+    {
+        waitPending(0);
+    }
+
+    // Block until at most maxPending tasks are queued or running: a producer
+    // submitting millions of tasks keeps the queue bounded.
+    void waitPending(size_t maxPending)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _taskDone.wait(lock, [this, maxPending] { return _pending <= maxPending; });
+    }
+
+private:
+    void workerLoop(size_t worker)
+    {
+        if (_onStart)
+            _onStart(worker);
+        for (;;)
+        {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _taskAvailable.wait(lock, [this] { return _stop || !_tasks.empty(); });
+                if (_tasks.empty())
+                    return;
+                task = std::move(_tasks.front());
+                _tasks.pop_front();
+            }
+
+            task();
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            --_pending;
+            _taskDone.notify_all();
+        }
+    }
+
+    WorkerStart _onStart;
+    std::vector<std::thread> _workers;
+    std::deque<Task> _tasks;
+    std::mutex _mutex;
+    std::condition_variable _taskAvailable;
+    std::condition_variable _taskDone;
+    size_t _pending = 0;
+    bool _stop = false;
+};
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class TraceStage : uint8_t
+{
+    Generate,
+    Sort,
+    Hash,
+    // several steps merged by a fusion
+    Fused,
+    Write,
+};
+
+// Start and end of every stage of every seed, for a Chrome trace
+// (chrome://tracing or ui.perfetto.dev) and per-stage percentiles.
+//
+// Every thread records into its own buffer, found through a thread_local
+// and registered once under a lock: recording is two clock reads and an
+// append, no sharing. A buffer keeps at most maxEvents, the rest is counted
+// as dropped.
+class Tracer
+{
+public:
+    static const size_t maxEvents = 1 << 20;
+
+    Tracer()
+        : _id(++s_lastId)
+        , _start(Clock::now())
+    {}
+
+    Tracer(Tracer const&) = delete;
+    Tracer& operator=(Tracer const&) = delete;
+
+    using Clock = std::chrono::steady_clock;
+
+    void record(TraceStage stage, size_t seed, Clock::time_point start, Clock::time_point end)
+    {
+        Buffer& buffer = localBuffer();
+        if (buffer.events.size() == maxEvents)
+        {
+            ++buffer.dropped;
+            return;
+        }
+        buffer.events.push_back(Event{seed, toNs(start), toNs(end), stage});
+    }
+
+    // Chrome trace-event JSON, one row per thread
+    bool writeChromeTrace(std::string const& path) const
+    {
+        std::ofstream file(path, std::ios_base::out | std::ios_base::trunc);
+        if (!file)
+            return false;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        for (size_t t = 0; t < _buffers.size(); ++t)
+        {
+            file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t
+                 << ",\"args\":{\"name\":\"worker " << t << "\"}}";
+            first = false;
+            for (Event const& event : _buffers[t]->events)
+            {
+                file << ",\n{\"name\":\"" << stageName(event.stage) << "\",\"cat\":\"seed\",\"ph\":\"X\",\"pid\":1,\"tid\":" << t
+                     << ",\"ts\":" << event.startNs / 1000 << '.' << std::setw(3) << std::setfill('0') << event.startNs % 1000
+                     << ",\"dur\":" << (event.endNs - event.startNs) / 1000 << '.' << std::setw(3)
+                     << (event.endNs - event.startNs) % 1000 << std::setfill(' ')
+                     << ",\"args\":{\"seed\":" << event.seed << "}}";
+            }
+        }
+        file << "\n]}\n";
+        return static_cast<bool>(file);
+    }
+
+    // count, p50, p99 and max duration per stage, with the seed of the max
+    void writeSummary(std::ostream& stream) const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::array<std::vector<Event const*>, stageCount> byStage;
+        size_t dropped = 0;
+        for (auto const& buffer : _buffers)
+        {
+            for (Event const& event : buffer->events)
+                byStage[static_cast<size_t>(event.stage)].push_back(&event);
+            dropped += buffer->dropped;
+        }
+
+        auto ms = [](int64_t ns) { return static_cast<double>(ns) * 1e-6; };
+        stream << std::setw(10) << "stage" << std::setw(10) << "count" << std::setw(10) << "p50_ms"
+               << std::setw(10) << "p99_ms" << std::setw(10) << "max_ms" << std::setw(12) << "max_seed" << std::endl;
+        stream << std::fixed << std::setprecision(3);
+        for (size_t s = 0; s < stageCount; ++s)
+        {
+            auto& events = byStage[s];
+            if (events.empty())
+                continue;
+            std::sort(events.begin(), events.end(), [](Event const* a, Event const* b) { return a->duration() < b->duration(); });
+            auto percentile = [&events](size_t p) { return events[(events.size() - 1) * p / 100]->duration(); };
+            stream << std::setw(10) << stageName(static_cast<TraceStage>(s)) << std::setw(10) << events.size()
+                   << std::setw(10) << ms(percentile(50)) << std::setw(10) << ms(percentile(99))
+                   << std::setw(10) << ms(events.back()->duration()) << std::setw(12) << events.back()->seed << std::endl;
+        }
+        stream.unsetf(std::ios_base::floatfield);
+        stream << std::setprecision(6);
+        if (dropped)
+            stream << dropped << " events dropped, over " << maxEvents << " per thread" << std::endl;
+    }
+
+private:
+    static const size_t stageCount = 5;
+
+    struct Event
+    {
+        uint64_t seed;
+        int64_t startNs;
+        int64_t endNs;
+        TraceStage stage;
+
+        int64_t duration() const { return endNs - startNs; }
+    };
+
+    struct Buffer
+    {
+        std::vector<Event> events;
+        size_t dropped = 0;
+    };
+
+    static char const* stageName(TraceStage stage)
+    {
+        static char const* const names[stageCount] = {"generate", "sort", "hash", "fused", "write"};
+        return names[static_cast<size_t>(stage)];
+    }
+
+    int64_t toNs(Clock::time_point time) const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time - _start).count();
+    }
+
+    Buffer& localBuffer()
+    {
+        // the id tells a buffer of this tracer from one of a tracer gone
+        thread_local uint64_t ownerId = 0;
+        thread_local Buffer* buffer = nullptr;
+        if (ownerId != _id)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _buffers.emplace_back(new Buffer());
+            buffer = _buffers.back().get();
+            ownerId = _id;
+        }
+        return *buffer;
+    }
+
+    static std::atomic<uint64_t> s_lastId;
+
+    uint64_t _id;
+    Clock::time_point _start;
+    std::vector<std::unique_ptr<Buffer>> _buffers;
+    mutable std::mutex _mutex;
+};
+
+inline std::atomic<uint64_t> Tracer::s_lastId{0};
+
+// Records the lifetime of the span as stage of seed, nothing without a tracer
+class TraceSpan
+{
+public:
+    TraceSpan(Tracer* tracer, TraceStage stage, size_t seed)
+        : _tracer(tracer)
+        , _stage(stage)
+        , _seed(seed)
+    {
+        if (_tracer)
+            _start = Tracer::Clock::now();
+    }
+
+    ~TraceSpan()
+    {
+        if (_tracer)
+            _tracer->record(_stage, _seed, _start, Tracer::Clock::now());
+    }
+
+    TraceSpan(TraceSpan const&) = delete;
+    TraceSpan& operator=(TraceSpan const&) = delete;
+
+private:
+    Tracer* _tracer;
+    TraceStage _stage;
+    size_t _seed;
+    Tracer::Clock::time_point _start;
+};
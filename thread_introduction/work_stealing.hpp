@@ -0,0 +1,312 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <random>
+#include <iostream>
+#include <iomanip>
+
+// Chase-Lev work-stealing deque (Le, Pop, Cohen, Zappa Nardelli 2013).
+// The owner pushes and pops at the bottom, thieves steal at the top.
+// Capacity is fixed: the scheduler below only ever holds O(log n) items.
+class ChaseLevDeque
+{
+public:
+    static const size_t capacity = 256;
+    static const uint64_t empty = ~uint64_t(0);
+
+    ChaseLevDeque()
+    {
+        for (auto& slot : _buffer)
+            slot.store(empty, std::memory_order_relaxed);
+    }
+
+    // Owner only. Returns false when the deque is full.
+    bool push(uint64_t item)
+    {
+        int64_t b = _bottom.load(std::memory_order_relaxed);
+        int64_t t = _top.load(std::memory_order_acquire);
+        if (b - t >= static_cast<int64_t>(capacity))
+            return false;
+        _buffer[b & (capacity - 1)].store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        _bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Owner only.
+    uint64_t pop()
+    {
+        int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+        _bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = _top.load(std::memory_order_relaxed);
+
+        uint64_t item = empty;
+        if (t <= b)
+        {
+            item = _buffer[b & (capacity - 1)].load(std::memory_order_relaxed);
+            if (t == b)
+            {
+                // last item, race against the thieves
+                if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    item = empty;
+                _bottom.store(b + 1, std::memory_order_relaxed);
+            }
+        }
+        else
+            _bottom.store(b + 1, std::memory_order_relaxed);
+        return item;
+    }
+
+    // Any thread. Returns empty when there is nothing or the race is lost.
+    uint64_t steal()
+    {
+        int64_t t = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = _bottom.load(std::memory_order_acquire);
+
+        if (t < b)
+        {
+            uint64_t item = _buffer[t & (capacity - 1)].load(std::memory_order_relaxed);
+            if (_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                return item;
+        }
+        return empty;
+    }
+
+private:
+    alignas(64) std::atomic<int64_t> _top{0};
+    alignas(64) std::atomic<int64_t> _bottom{0};
+    alignas(64) std::atomic<uint64_t> _buffer[capacity];
+};
+
+// Runs job(index) for every index of [0, count) on workers started once by
+// the constructor, which sleep between runs. Worker stats add up over the
+// runs of a scheduler.
+// Items are index ranges packed in 64 bits (begin << 32 | end). Each worker
+// starts with a contiguous share; before running an index it splits its
+// range in halves and pushes the upper halves, so thieves always take the
+// biggest pending range and a deque never holds more than log2(count) items.
+// With a step, only [0, step) is shared at first: a worker that finds
+// nothing to pop or steal takes the next step indices for itself, so the
+// running indices stay close to each other.
+class WorkStealingScheduler
+{
+public:
+    struct WorkerStats
+    {
+        std::chrono::nanoseconds busy{0};
+        std::chrono::nanoseconds idle{0};
+        size_t tasks = 0;
+        size_t steals = 0;
+        size_t failedSteals = 0;
+    };
+
+    using Job = std::function<void(size_t index)>;
+    // called on each worker thread with its index, before any job
+    using WorkerStart = std::function<void(size_t worker)>;
+
+    explicit WorkStealingScheduler(size_t nbThreads, WorkerStart onStart = WorkerStart())
+        : _deques(nbThreads ? nbThreads : 1)
+        , _stats(_deques.size())
+        , _onStart(std::move(onStart))
+    {
+        _workers.reserve(_deques.size());
+        for (size_t w = 0; w < _deques.size(); ++w)
+            _workers.emplace_back([this, w] { workerThread(w); });
+    }
+
+    WorkStealingScheduler(WorkStealingScheduler const&) = delete;
+    WorkStealingScheduler& operator=(WorkStealingScheduler const&) = delete;
+
+    ~WorkStealingScheduler()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _wake.notify_all();
+        for (auto& worker : _workers)
+            worker.join();
+    }
+
+    // Returns once job has run for every index. step 0 shares them all at once.
+    void run(size_t count, Job job, size_t step = 0)
+    {
+        if (count == 0)
+            return;
+        size_t const nbThreads = _deques.size();
+        size_t const shared = step && step < count ? step : count;
+        _job = std::move(job);
+        _count = count;
+        _step = step ? step : count;
+        _released.store(shared, std::memory_order_relaxed);
+        _remaining.store(count, std::memory_order_relaxed);
+
+        for (size_t w = 0; w < nbThreads; ++w)
+        {
+            uint64_t begin = shared * w / nbThreads;
+            uint64_t end = shared * (w + 1) / nbThreads;
+            if (begin != end)
+                _deques[w].push(pack(begin, end));
+        }
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _running = nbThreads;
+        ++_generation;
+        _wake.notify_all();
+        _done.wait(lock, [this] { return _running == 0; });
+        _job = Job();
+    }
+
+    std::vector<WorkerStats> const& stats() const { return _stats; }
+
+    void writeStats(std::ostream& stream) const
+    {
+        stream << std::setw(8) << "worker" << std::setw(12) << "busy_ms" << std::setw(12) << "idle_ms"
+               << std::setw(10) << "tasks" << std::setw(10) << "steals" << std::setw(10) << "failed" << std::endl;
+        for (size_t w = 0; w < _stats.size(); ++w)
+        {
+            auto const& s = _stats[w];
+            stream << std::setw(8) << w
+                   << std::setw(12) << std::chrono::duration_cast<std::chrono::milliseconds>(s.busy).count()
+                   << std::setw(12) << std::chrono::duration_cast<std::chrono::milliseconds>(s.idle).count()
+                   << std::setw(10) << s.tasks
+                   << std::setw(10) << s.steals
+                   << std::setw(10) << s.failedSteals << std::endl;
+        }
+    }
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    static uint64_t pack(uint64_t begin, uint64_t end) { return (begin << 32) | end; }
+    static uint64_t rangeBegin(uint64_t item) { return item >> 32; }
+    static uint64_t rangeEnd(uint64_t item) { return item & 0xffffffff; }
+
+    void workerThread(size_t w)
+    {
+        if (_onStart)
+            _onStart(w);
+        size_t generation = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _wake.wait(lock, [this, generation] { return _stop || _generation != generation; });
+                if (_stop)
+                    return;
+                generation = _generation;
+            }
+
+            workerLoop(w);
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (--_running == 0)
+                _done.notify_one();
+        }
+    }
+
+    void workerLoop(size_t w)
+    {
+        ChaseLevDeque& deque = _deques[w];
+        WorkerStats& stats = _stats[w];
+        std::minstd_rand random(static_cast<uint32_t>(w + 1));
+
+        auto idleSince = clock::now();
+        while (_remaining.load(std::memory_order_acquire) > 0)
+        {
+            uint64_t item = deque.pop();
+            if (item == ChaseLevDeque::empty)
+            {
+                item = stealFrom(w, random, stats);
+                if (item == ChaseLevDeque::empty)
+                    item = releaseNext();
+                if (item == ChaseLevDeque::empty)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+            }
+
+            auto start = clock::now();
+            stats.idle += start - idleSince;
+
+            uint64_t begin = rangeBegin(item);
+            uint64_t end = rangeEnd(item);
+            while (end - begin > 1)
+            {
+                uint64_t middle = begin + (end - begin) / 2;
+                if (!deque.push(pack(middle, end)))
+                    break;
+                end = middle;
+            }
+            for (uint64_t i = begin; i < end; ++i)
+            {
+                _job(static_cast<size_t>(i));
+                ++stats.tasks;
+            }
+            _remaining.fetch_sub(end - begin, std::memory_order_acq_rel);
+
+            idleSince = clock::now();
+            stats.busy += idleSince - start;
+        }
+        stats.idle += clock::now() - idleSince;
+    }
+
+    // The next step indices not shared yet, empty once they all are
+    uint64_t releaseNext()
+    {
+        if (_released.load(std::memory_order_relaxed) >= _count)
+            return ChaseLevDeque::empty;
+        size_t begin = _released.fetch_add(_step, std::memory_order_relaxed);
+        if (begin >= _count)
+            return ChaseLevDeque::empty;
+        return pack(begin, std::min(begin + _step, _count));
+    }
+
+    uint64_t stealFrom(size_t w, std::minstd_rand& random, WorkerStats& stats)
+    {
+        size_t const nbThreads = _deques.size();
+        if (nbThreads < 2)
+            return ChaseLevDeque::empty;
+
+        size_t victim = random() % (nbThreads - 1);
+        if (victim >= w)
+            ++victim;
+        uint64_t item = _deques[victim].steal();
+        if (item == ChaseLevDeque::empty)
+            ++stats.failedSteals;
+        else
+            ++stats.steals;
+        return item;
+    }
+
+    std::vector<ChaseLevDeque> _deques;
+    std::vector<WorkerStats> _stats;
+    WorkerStart _onStart;
+    std::vector<std::thread> _workers;
+
+    // set by run while the workers sleep
+    Job _job;
+    size_t _count = 0;
+    size_t _step = 0;
+    std::atomic<size_t> _released{0};
+    std::atomic<size_t> _remaining{0};
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    size_t _generation = 0;
+    size_t _running = 0;
+    bool _stop = false;
+};
@@ -0,0 +1,306 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "buffer_pool.hpp"
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+// The CPUs this process may run on, with their NUMA node and physical core,
+// read from sysfs. Without sysfs, with sysfs content it cannot parse (or off
+// Linux) there is a single node and no CPU is known.
+class CpuTopology
+{
+public:
+    struct Cpu
+    {
+        int id = 0;
+        // index among the nodes with a CPU, 0 to nodeCount() - 1
+        int node = 0;
+        // as numbered by sysfs, possibly sparse
+        int nodeId = 0;
+        int package = 0;
+        int core = 0;
+    };
+
+    static CpuTopology detect(std::string const& sysfs = "/sys/devices/system")
+    {
+        CpuTopology topology;
+#ifdef __linux__
+        try
+        {
+            topology.read(sysfs);
+        }
+        catch (std::exception const&)
+        {
+            return CpuTopology();
+        }
+#else
+        (void)sysfs;
+#endif
+        return topology;
+    }
+
+    std::vector<Cpu> const& cpus() const { return _cpus; }
+
+    size_t nodeCount() const
+    {
+        return std::max<size_t>(1, _nodeIds.size());
+    }
+
+    // sysfs id of each node index
+    int nodeId(size_t node) const
+    {
+        return node < _nodeIds.size() ? _nodeIds[node] : 0;
+    }
+
+    // CPU of each worker: the nodes in turn, so the workers spread evenly,
+    // and within a node one CPU per physical core before the SMT siblings
+    std::vector<Cpu> workerCpus(size_t nbWorkers) const
+    {
+        std::vector<std::vector<Cpu>> byNode(nodeCount());
+        for (auto const& cpu : _cpus)
+            byNode[static_cast<size_t>(cpu.node)].push_back(cpu);
+        for (auto& node : byNode)
+        {
+            // rank of a CPU among the SMT siblings of its core
+            std::vector<std::pair<size_t, Cpu>> ranked;
+            for (auto const& cpu : node)
+            {
+                size_t rank = 0;
+                for (auto const& other : ranked)
+                    rank += other.second.package == cpu.package && other.second.core == cpu.core;
+                ranked.emplace_back(rank, cpu);
+            }
+            std::stable_sort(ranked.begin(), ranked.end(),
+                             [](std::pair<size_t, Cpu> const& a, std::pair<size_t, Cpu> const& b) { return a.first < b.first; });
+            for (size_t i = 0; i < node.size(); ++i)
+                node[i] = ranked[i].second;
+        }
+        byNode.erase(std::remove_if(byNode.begin(), byNode.end(), [](std::vector<Cpu> const& node) { return node.empty(); }),
+                     byNode.end());
+
+        std::vector<Cpu> result;
+        for (size_t w = 0; w < nbWorkers && !byNode.empty(); ++w)
+        {
+            auto const& node = byNode[w % byNode.size()];
+            result.push_back(node[(w / byNode.size()) % node.size()]);
+        }
+        return result;
+    }
+
+private:
+#ifdef __linux__
+    void read(std::string const& sysfs)
+    {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        bool const hasAffinity = ::sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+        for (int id : parseList(readLine(sysfs + "/cpu/online")))
+        {
+            // a cpu_set_t cannot name the CPUs past CPU_SETSIZE, start() could
+            // not pin a worker there
+            if (id < 0 || id >= CPU_SETSIZE || (hasAffinity && !CPU_ISSET(id, &allowed)))
+                continue;
+            std::string const dir = sysfs + "/cpu/cpu" + std::to_string(id) + "/topology/";
+            Cpu cpu;
+            cpu.id = id;
+            cpu.package = readInt(dir + "physical_package_id");
+            cpu.core = readInt(dir + "core_id");
+            _cpus.push_back(cpu);
+        }
+        // the online nodes, ids possibly sparse, each listing its CPUs;
+        // absent on kernels without NUMA
+        for (int node : parseList(readLine(sysfs + "/node/online")))
+        {
+            for (int id : parseList(readLine(sysfs + "/node/node" + std::to_string(node) + "/cpulist")))
+            {
+                for (auto& cpu : _cpus)
+                {
+                    if (cpu.id == id)
+                        cpu.nodeId = node;
+                }
+            }
+        }
+        for (auto const& cpu : _cpus)
+            _nodeIds.push_back(cpu.nodeId);
+        std::sort(_nodeIds.begin(), _nodeIds.end());
+        _nodeIds.erase(std::unique(_nodeIds.begin(), _nodeIds.end()), _nodeIds.end());
+        for (auto& cpu : _cpus)
+        {
+            auto index = std::lower_bound(_nodeIds.begin(), _nodeIds.end(), cpu.nodeId) - _nodeIds.begin();
+            cpu.node = static_cast<int>(index);
+        }
+    }
+#endif
+
+    static std::string readLine(std::string const& path)
+    {
+        std::ifstream file(path);
+        std::string line;
+        std::getline(file, line);
+        return line;
+    }
+
+    static int readInt(std::string const& path)
+    {
+        std::string line = readLine(path);
+        return line.empty() ? 0 : std::stoi(line);
+    }
+
+    // "0-3,8,10-11", throws on anything else
+    static std::vector<int> parseList(std::string const& list)
+    {
+        std::vector<int> ids;
+        std::stringstream stream(list);
+        std::string range;
+        while (std::getline(stream, range, ','))
+        {
+            if (range.empty())
+                continue;
+            size_t dash = range.find('-');
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            if (first < 0 || last < first || last - first > maxListRange)
+                throw std::out_of_range("cpu list " + range);
+            for (int id = first; id <= last; ++id)
+                ids.push_back(id);
+        }
+        return ids;
+    }
+
+    // no machine has more CPUs than that in a single range
+    static const int maxListRange = 1 << 16;
+
+    std::vector<Cpu> _cpus;
+    std::vector<int> _nodeIds;
+};
+
+// Pins every worker of a scheduler to its CPU from CpuTopology and gives it
+// its own BufferPool: the buffers a worker allocates are first touched by
+// it, so they live on its node and are recycled there. The seeds each node
+// completes are counted.
+//
+// On a single node machine there is nothing to keep local: no worker is
+// pinned and no arena is created, only the counting remains.
+class WorkerPlacement
+{
+public:
+    WorkerPlacement(CpuTopology const& topology, size_t nbWorkers, bool hugePages)
+        : _topology(topology)
+        , _cpus(topology.workerCpus(nbWorkers))
+        , _active(topology.nodeCount() > 1)
+        , _nodes(topology.nodeCount())
+        , _id(++s_lastId)
+    {
+        if (_active)
+        {
+            for (size_t w = 0; w < _cpus.size(); ++w)
+                _arenas.emplace_back(new BufferPool(hugePages));
+        }
+    }
+
+    WorkerPlacement(WorkerPlacement const&) = delete;
+    WorkerPlacement& operator=(WorkerPlacement const&) = delete;
+
+    bool active() const { return _active; }
+
+    // On worker w's thread, before its first task
+    void start(size_t worker)
+    {
+        t_placementId = _id;
+        t_worker = worker;
+        if (!_active || worker >= _cpus.size())
+            return;
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(_cpus[worker].id, &set);
+        if (::sched_setaffinity(0, sizeof(set), &set) != 0)
+            ++_pinFailures;
+#endif
+    }
+
+    // Arena of the calling worker, nullptr on any other thread
+    BufferPool* localArena() const
+    {
+        if (!_active || t_placementId != _id || t_worker >= _arenas.size())
+            return nullptr;
+        return _arenas[t_worker].get();
+    }
+
+    // Counts a seed of values numbers for the node of the calling worker
+    void seedDone(size_t values)
+    {
+        Node& node = _nodes[nodeOfCaller()];
+        node.seeds.fetch_add(1, std::memory_order_relaxed);
+        node.values.fetch_add(values, std::memory_order_relaxed);
+    }
+
+    void writeStats(std::ostream& stream, double seconds) const
+    {
+        stream << "placement: " << _nodes.size() << " node(s), "
+               << (_active ? "workers pinned, one arena each" : "single node, nothing pinned");
+        if (_pinFailures)
+            stream << ", " << _pinFailures.load() << " pinning failures";
+        stream << std::endl;
+        stream << std::setw(8) << "node" << std::setw(10) << "workers" << std::setw(10) << "seeds"
+               << std::setw(12) << "seeds/s" << std::setw(12) << "Mvalues/s" << std::endl;
+        stream << std::fixed << std::setprecision(1);
+        for (size_t n = 0; n < _nodes.size(); ++n)
+        {
+            size_t workers = 0;
+            for (auto const& cpu : _cpus)
+                workers += static_cast<size_t>(cpu.node) == n;
+            double const s = seconds > 0. ? seconds : 1.;
+            stream << std::setw(8) << _topology.nodeId(n) << std::setw(10) << workers << std::setw(10) << _nodes[n].seeds.load()
+                   << std::setw(12) << _nodes[n].seeds.load() / s
+                   << std::setw(12) << static_cast<double>(_nodes[n].values.load()) / s * 1e-6 << std::endl;
+        }
+        stream.unsetf(std::ios_base::floatfield);
+        stream << std::setprecision(6);
+    }
+
+private:
+    struct alignas(64) Node
+    {
+        std::atomic<size_t> seeds{0};
+        std::atomic<size_t> values{0};
+    };
+
+    size_t nodeOfCaller() const
+    {
+        if (t_placementId != _id || t_worker >= _cpus.size())
+            return 0;
+        return static_cast<size_t>(_cpus[t_worker].node) % _nodes.size();
+    }
+
+    static std::atomic<uint64_t> s_lastId;
+    static thread_local uint64_t t_placementId;
+    static thread_local size_t t_worker;
+
+    CpuTopology _topology;
+    std::vector<CpuTopology::Cpu> _cpus;
+    bool _active;
+    std::vector<Node> _nodes;
+    std::vector<std::unique_ptr<BufferPool>> _arenas;
+    std::atomic<size_t> _pinFailures{0};
+    uint64_t _id;
+};
+
+inline std::atomic<uint64_t> WorkerPlacement::s_lastId{0};
+inline thread_local uint64_t WorkerPlacement::t_placementId = 0;
+inline thread_local size_t WorkerPlacement::t_worker = 0;